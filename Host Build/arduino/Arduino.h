@@ -0,0 +1,49 @@
+/**
+ * The Flying Squirrels: Squirrel Lighting Controller
+ * Purpose: Host build shim, minimal Arduino core for compiling the shared
+ *          libraries off-device. Only what the libraries and benchmarks actually
+ *          use is here.
+ * Date:    2026-10-17
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <math.h>
+#include <ctype.h>
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define PROGMEM
+#define ICACHE_RAM_ATTR
+#define PSTR(s) (s)
+#define F(s) (s)
+#define memcpy_P memcpy
+#define strcmp_P strcmp
+#define strlen_P strlen
+#define pgm_read_byte(addr) (*(const uint8_t*)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t*)(addr))
+#define pgm_read_ptr(addr) (*(void* const*)(addr))
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long);
+void delayMicroseconds(unsigned int);
+void yield();
+long random(long);
+long random(long, long);
+void randomSeed(unsigned long);
+inline bool isAscii(int c) { return c >= 0 && c < 128; }
+
+#include "WString.h"
+#include "Print.h"
+#include "Stream.h"
+#include "IPAddress.h"
+#include "Esp.h"
+#include "HardwareSerial.h"
@@ -0,0 +1,10 @@
+/**
+ * The Flying Squirrels: Squirrel Lighting Controller
+ * Purpose: Host build shim, the libraries include this header only for the core
+ *          types.
+ * Date:    2026-10-17
+ */
+
+#pragma once
+
+#include "Arduino.h"
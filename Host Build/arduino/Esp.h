@@ -0,0 +1,17 @@
+/**
+ * The Flying Squirrels: Squirrel Lighting Controller
+ * Purpose: Host build shim, the few EspClass members the libraries call
+ * Date:    2026-10-17
+ */
+
+#pragma once
+
+class EspClass {
+public:
+  uint32_t getCycleCount();
+  uint32_t getFreeHeap();
+  uint32_t getCpuFreqMHz() { return 80; }
+  void restart() { exit(0); }
+};
+
+extern EspClass ESP;
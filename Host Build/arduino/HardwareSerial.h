@@ -0,0 +1,27 @@
+/**
+ * The Flying Squirrels: Squirrel Lighting Controller
+ * Purpose: Host build shim, Serial reads stdin (non-blocking) and writes stdout
+ * Date:    2026-10-17
+ */
+
+#pragma once
+
+class HardwareSerial : public Stream {
+public:
+  void begin(unsigned long) {}
+  virtual int available();
+  virtual int read();
+  virtual int peek();
+  virtual void flush();
+  virtual size_t write(uint8_t);
+  virtual size_t write(const uint8_t*, size_t);
+  using Print::write;
+
+  void setQuiet(bool quiet) { this->quiet = quiet; }
+
+private:
+  bool quiet = false;
+  int peeked = -1;
+};
+
+extern HardwareSerial Serial;
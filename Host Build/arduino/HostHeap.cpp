@@ -0,0 +1,45 @@
+/**
+ * The Flying Squirrels: Squirrel Lighting Controller
+ * Purpose: Host build shim, counting wrappers around the libc allocator
+ * Date:    2026-10-17
+ */
+
+//glibc exports __libc_* entry points, so the counting wrappers can forward
+//without dlsym
+
+#include "HostHeap.h"
+#include <stddef.h>
+
+extern "C" {
+void* __libc_malloc(size_t);
+void* __libc_calloc(size_t, size_t);
+void* __libc_realloc(void*, size_t);
+void __libc_free(void*);
+}
+
+static uint32_t allocationCount = 0;
+static uint32_t freeCount = 0;
+
+extern "C" void* malloc(size_t size) {
+  allocationCount++;
+  return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t count, size_t size) {
+  allocationCount++;
+  return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* pointer, size_t size) {
+  allocationCount++;
+  return __libc_realloc(pointer, size);
+}
+
+extern "C" void free(void* pointer) {
+  if (pointer)
+    freeCount++;
+  __libc_free(pointer);
+}
+
+uint32_t HostHeap::allocations() { return allocationCount; }
+uint32_t HostHeap::frees() { return freeCount; }
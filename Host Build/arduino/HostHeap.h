@@ -0,0 +1,15 @@
+/**
+ * The Flying Squirrels: Squirrel Lighting Controller
+ * Purpose: Host build shim, counts heap allocations made by the process so the
+ *          benchmarks can report allocations per command.
+ * Date:    2026-10-17
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+namespace HostHeap {
+  uint32_t allocations();
+  uint32_t frees();
+}
@@ -0,0 +1,82 @@
+/**
+ * The Flying Squirrels: Squirrel Lighting Controller
+ * Purpose: Host build shim, simulated node addresses on loopback
+ * Date:    2026-10-17
+ */
+
+#include "HostNet.h"
+#include <arpa/inet.h>
+
+namespace {
+  IPAddress localAddress(192, 168, 3, 1);
+  const int MAX_BINDINGS = 256;
+  struct Binding {
+    uint32_t address;
+    uint16_t port;
+  };
+  Binding bindings[MAX_BINDINGS];
+  int bindingCount = 0;
+  uint32_t sentDatagrams = 0;
+  uint32_t sentBytes = 0;
+  int lossPercent = 0;
+  uint32_t lostDatagrams = 0;
+  //Own generator, so loss patterns repeat regardless of random() use
+  uint32_t lossState = 12345;
+}
+
+namespace HostNet {
+  void countSend(size_t bytes) {
+    sentDatagrams++;
+    sentBytes += bytes;
+  }
+
+  bool loseDatagram() {
+    if (lossPercent <= 0)
+      return false;
+    lossState = lossState * 1103515245u + 12345u;
+    if ((int)((lossState >> 16) % 100) >= lossPercent)
+      return false;
+    lostDatagrams++;
+    return true;
+  }
+}
+
+void HostNet::setLocalAddress(IPAddress address) { localAddress = address; }
+IPAddress HostNet::getLocalAddress() { return localAddress; }
+
+uint32_t HostNet::toLoopback(IPAddress address) {
+  return htonl(0x7F000000u | address[3]);
+}
+
+IPAddress HostNet::fromLoopback(uint32_t address) {
+  IPAddress simulated = localAddress;
+  simulated[3] = (uint8_t)(ntohl(address) & 0xFF);
+  return simulated;
+}
+
+void HostNet::registerBinding(IPAddress address, uint16_t port) {
+  if (bindingCount < MAX_BINDINGS)
+    bindings[bindingCount++] = {(uint32_t)address, port};
+}
+
+void HostNet::unregisterBinding(IPAddress address, uint16_t port) {
+  for (int i = 0; i < bindingCount; i++) {
+    if (bindings[i].address == (uint32_t)address && bindings[i].port == port) {
+      bindings[i] = bindings[--bindingCount];
+      return;
+    }
+  }
+}
+
+int HostNet::getBindings(uint16_t port, IPAddress* out, int max) {
+  int count = 0;
+  for (int i = 0; i < bindingCount && count < max; i++)
+    if (bindings[i].port == port)
+      out[count++] = IPAddress(bindings[i].address);
+  return count;
+}
+
+uint32_t HostNet::datagramsSent() { return sentDatagrams; }
+uint32_t HostNet::bytesSent() { return sentBytes; }
+void HostNet::setLossPercent(int percent) { lossPercent = percent; }
+uint32_t HostNet::datagramsLost() { return lostDatagrams; }
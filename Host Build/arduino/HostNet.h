@@ -0,0 +1,35 @@
+/**
+ * The Flying Squirrels: Squirrel Lighting Controller
+ * Purpose: Host build shim, maps the simulated 192.168.3.0/24 network onto
+ *          loopback. Each simulated node owns 127.0.0.<last octet>, so several
+ *          nodes can bind the same port inside one process, exactly like separate
+ *          ESP8266 modules.
+ * Date:    2026-10-17
+ */
+
+#pragma once
+
+#include "Arduino.h"
+
+namespace HostNet {
+  //Address that subsequently opened sockets bind to (the "current node")
+  void setLocalAddress(IPAddress);
+  IPAddress getLocalAddress();
+
+  //Conversions between simulated and loopback addresses
+  uint32_t toLoopback(IPAddress);
+  IPAddress fromLoopback(uint32_t);
+
+  //Ports bound by any node, used to fan out subnet broadcasts
+  void registerBinding(IPAddress, uint16_t);
+  void unregisterBinding(IPAddress, uint16_t);
+  int getBindings(uint16_t port, IPAddress* out, int max);
+
+  //Datagram counters for benchmarks
+  uint32_t datagramsSent();
+  uint32_t bytesSent();
+
+  //Drops the given percentage of sent datagrams, to exercise retransmission
+  void setLossPercent(int);
+  uint32_t datagramsLost();
+}
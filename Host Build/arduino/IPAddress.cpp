@@ -0,0 +1,47 @@
+/**
+ * The Flying Squirrels: Squirrel Lighting Controller
+ * Purpose: Host build shim, IPv4 address parsing and printing
+ * Date:    2026-10-17
+ */
+
+#include "Arduino.h"
+
+bool IPAddress::fromString(const char* text) {
+  uint16_t acc = 0;
+  uint8_t dots = 0;
+  uint8_t parsed[4] = {0, 0, 0, 0};
+  bool digit = false;
+  for (; *text; text++) {
+    char c = *text;
+    if (c >= '0' && c <= '9') {
+      acc = acc * 10 + (c - '0');
+      digit = true;
+      if (acc > 255)
+        return false;
+    } else if (c == '.') {
+      if (dots == 3 || !digit)
+        return false;
+      parsed[dots++] = (uint8_t)acc;
+      acc = 0;
+      digit = false;
+    } else {
+      return false;
+    }
+  }
+  if (dots != 3 || !digit)
+    return false;
+  parsed[3] = (uint8_t)acc;
+  for (int i = 0; i < 4; i++)
+    bytes[i] = parsed[i];
+  return true;
+}
+
+String IPAddress::toString() const {
+  char text[16];
+  snprintf(text, sizeof(text), "%u.%u.%u.%u", bytes[0], bytes[1], bytes[2], bytes[3]);
+  return String(text);
+}
+
+size_t IPAddress::printTo(Print& p) const {
+  return p.print(toString());
+}
@@ -0,0 +1,35 @@
+/**
+ * The Flying Squirrels: Squirrel Lighting Controller
+ * Purpose: Host build shim, IPv4 address in network byte order, like the core
+ * Date:    2026-10-17
+ */
+
+#pragma once
+
+class IPAddress : public Printable {
+public:
+  IPAddress() : address(0) {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) {
+    bytes[0] = a; bytes[1] = b; bytes[2] = c; bytes[3] = d;
+  }
+  IPAddress(uint32_t value) : address(value) {}
+
+  operator uint32_t() const { return address; }
+  bool operator==(const IPAddress& other) const { return address == other.address; }
+  bool operator!=(const IPAddress& other) const { return address != other.address; }
+  bool operator==(uint32_t other) const { return address == other; }
+  bool operator!=(uint32_t other) const { return address != other; }
+  uint8_t operator[](int index) const { return bytes[index]; }
+  uint8_t& operator[](int index) { return bytes[index]; }
+
+  bool fromString(const char*);
+  bool fromString(const String& text) { return fromString(text.c_str()); }
+  String toString() const;
+  virtual size_t printTo(Print&) const;
+
+private:
+  union {
+    uint8_t bytes[4];
+    uint32_t address;
+  };
+};
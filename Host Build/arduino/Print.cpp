@@ -0,0 +1,70 @@
+/**
+ * The Flying Squirrels: Squirrel Lighting Controller
+ * Purpose: Host build shim, Print formatting
+ * Date:    2026-10-17
+ */
+
+#include "Arduino.h"
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+  size_t written = 0;
+  while (size--) {
+    if (!write(*buffer++))
+      break;
+    written++;
+  }
+  return written;
+}
+
+//Mirrors the core: format into a small stack buffer, fall back to heap
+size_t Print::printf(const char* format, ...) {
+  va_list arg;
+  va_start(arg, format);
+  char temp[64];
+  char* buffer = temp;
+  size_t len = vsnprintf(temp, sizeof(temp), format, arg);
+  va_end(arg);
+  if (len > sizeof(temp) - 1) {
+    buffer = new char[len + 1];
+    va_start(arg, format);
+    vsnprintf(buffer, len + 1, format, arg);
+    va_end(arg);
+  }
+  len = write((const uint8_t*)buffer, len);
+  if (buffer != temp)
+    delete[] buffer;
+  return len;
+}
+
+size_t Print::print(const String& text) { return write((const uint8_t*)text.c_str(), text.length()); }
+size_t Print::print(const char* text) { return write(text); }
+size_t Print::print(char value) { return write((uint8_t)value); }
+size_t Print::print(unsigned char value, int base) { return print((unsigned long)value, base); }
+size_t Print::print(int value, int base) { return print((long)value, base); }
+size_t Print::print(unsigned int value, int base) { return print((unsigned long)value, base); }
+
+size_t Print::print(long value, int base) {
+  char text[24];
+  snprintf(text, sizeof(text), base == 16 ? "%lx" : "%ld", value);
+  return write(text);
+}
+
+size_t Print::print(unsigned long value, int base) {
+  char text[24];
+  snprintf(text, sizeof(text), base == 16 ? "%lx" : "%lu", value);
+  return write(text);
+}
+
+size_t Print::print(double value, int digits) {
+  char text[40];
+  snprintf(text, sizeof(text), "%.*f", digits, value);
+  return write(text);
+}
+
+size_t Print::print(const Printable& value) { return value.printTo(*this); }
+size_t Print::println(const String& text) { return print(text) + println(); }
+size_t Print::println(const char* text) { return print(text) + println(); }
+size_t Print::println(int value, int base) { return print(value, base) + println(); }
+size_t Print::println(unsigned long value, int base) { return print(value, base) + println(); }
+size_t Print::println(const Printable& value) { return print(value) + println(); }
+size_t Print::println() { return write("\r\n"); }
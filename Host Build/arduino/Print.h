@@ -0,0 +1,43 @@
+/**
+ * The Flying Squirrels: Squirrel Lighting Controller
+ * Purpose: Host build shim, Print base class
+ * Date:    2026-10-17
+ */
+
+#pragma once
+
+class String;
+class Printable;
+
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t) = 0;
+  virtual size_t write(const uint8_t* buffer, size_t size);
+  size_t write(const char* text) { return text ? write((const uint8_t*)text, strlen(text)) : 0; }
+  size_t write(const char* buffer, size_t size) { return write((const uint8_t*)buffer, size); }
+
+  size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+  size_t print(const String&);
+  size_t print(const char*);
+  size_t print(char);
+  size_t print(unsigned char, int = 10);
+  size_t print(int, int = 10);
+  size_t print(unsigned int, int = 10);
+  size_t print(long, int = 10);
+  size_t print(unsigned long, int = 10);
+  size_t print(double, int = 2);
+  size_t print(const Printable&);
+  size_t println(const String&);
+  size_t println(const char*);
+  size_t println(int, int = 10);
+  size_t println(unsigned long, int = 10);
+  size_t println(const Printable&);
+  size_t println();
+};
+
+class Printable {
+public:
+  virtual ~Printable() {}
+  virtual size_t printTo(Print&) const = 0;
+};
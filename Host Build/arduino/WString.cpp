@@ -0,0 +1,192 @@
+/**
+ * The Flying Squirrels: Squirrel Lighting Controller
+ * Purpose: Host build shim, Arduino String
+ * Date:    2026-10-17
+ */
+
+#include "Arduino.h"
+
+size_t String::strlenSafe(const char* value) {
+  return value ? strlen(value) : 0;
+}
+
+String::String(const char* value) { assign(value, strlenSafe(value)); }
+String::String(const String& other) { assign(other.c_str(), other.len); }
+String::String(char value) { assign(&value, 1); }
+
+static void formatInteger(char* out, unsigned long long value, bool negative, unsigned char base) {
+  char digits[72];
+  int count = 0;
+  do {
+    int digit = (int)(value % base);
+    digits[count++] = (char)(digit < 10 ? '0' + digit : 'a' + digit - 10);
+    value /= base;
+  } while (value);
+  if (negative)
+    *out++ = '-';
+  while (count)
+    *out++ = digits[--count];
+  *out = '\0';
+}
+
+String::String(int value, unsigned char base) : String((long)value, base) {}
+String::String(unsigned int value, unsigned char base) : String((unsigned long)value, base) {}
+String::String(unsigned char value, unsigned char base) : String((unsigned long)value, base) {}
+String::String(long value, unsigned char base) {
+  char text[72];
+  bool negative = value < 0 && base == 10;
+  unsigned long long magnitude = negative ? (unsigned long long)(-(long long)value) : (unsigned long)value;
+  formatInteger(text, magnitude, negative, base);
+  assign(text, strlen(text));
+}
+String::String(unsigned long value, unsigned char base) {
+  char text[72];
+  formatInteger(text, value, false, base);
+  assign(text, strlen(text));
+}
+String::String(float value, unsigned char decimals) : String((double)value, decimals) {}
+String::String(double value, unsigned char decimals) {
+  char text[64];
+  snprintf(text, sizeof(text), "%.*f", decimals, value);
+  assign(text, strlen(text));
+}
+
+String::~String() { free(buffer); }
+
+String& String::operator=(const String& other) {
+  if (this != &other)
+    assign(other.c_str(), other.len);
+  return *this;
+}
+
+String& String::operator=(const char* other) {
+  assign(other, strlenSafe(other));
+  return *this;
+}
+
+String& String::operator+=(char value) {
+  concat(&value, 1);
+  return *this;
+}
+
+char& String::operator[](unsigned int index) {
+  static char dummy;
+  if (index >= len) {
+    dummy = 0;
+    return dummy;
+  }
+  return buffer[index];
+}
+
+String operator+(const String& left, const String& right) {
+  String result(left);
+  result += right;
+  return result;
+}
+
+String operator+(const String& left, const char* right) {
+  String result(left);
+  result += right;
+  return result;
+}
+
+String operator+(const String& left, char right) {
+  String result(left);
+  result += right;
+  return result;
+}
+
+bool String::reserve(unsigned int size) {
+  if (buffer && capacity >= size)
+    return true;
+  char* grown = (char*)realloc(buffer, size + 1);
+  if (!grown)
+    return false;
+  if (!buffer)
+    grown[0] = '\0';
+  buffer = grown;
+  capacity = size;
+  return true;
+}
+
+void String::assign(const char* value, size_t length) {
+  if (!reserve(length))
+    return;
+  if (length)
+    memmove(buffer, value, length);
+  buffer[length] = '\0';
+  len = length;
+}
+
+void String::concat(const char* value, size_t length) {
+  if (!length)
+    return;
+  if (!reserve(len + length))
+    return;
+  memmove(buffer + len, value, length);
+  len += length;
+  buffer[len] = '\0';
+}
+
+/**
+ * Drops count characters from index on, keeping the buffer like the core does.
+ */
+void String::remove(unsigned int index, unsigned int count) {
+  if (index >= len)
+    return;
+  if (count > len - index)
+    count = len - index;
+  memmove(buffer + index, buffer + index + count, len - index - count);
+  len -= count;
+  buffer[len] = '\0';
+}
+
+bool String::equals(const String& other) const {
+  return len == other.len && strcmp(c_str(), other.c_str()) == 0;
+}
+
+bool String::equals(const char* other) const {
+  return strcmp(c_str(), other ? other : "") == 0;
+}
+
+void String::replace(const char* find, const char* replacement) {
+  size_t findLength = strlenSafe(find);
+  if (!findLength || !len)
+    return;
+  String result;
+  const char* cursor = c_str();
+  const char* match;
+  while ((match = strstr(cursor, find)) != nullptr) {
+    result.concat(cursor, match - cursor);
+    result.concat(replacement, strlenSafe(replacement));
+    cursor = match + findLength;
+  }
+  result.concat(cursor, strlen(cursor));
+  *this = result;
+}
+
+long String::toInt() const { return atol(c_str()); }
+float String::toFloat() const { return (float)atof(c_str()); }
+
+void String::trim() {
+  unsigned int start = 0, end = len;
+  while (start < end && isspace((unsigned char)buffer[start])) start++;
+  while (end > start && isspace((unsigned char)buffer[end - 1])) end--;
+  String result = substring(start, end);
+  *this = result;
+}
+
+int String::indexOf(char value, unsigned int from) const {
+  for (unsigned int i = from; i < len; i++)
+    if (buffer[i] == value)
+      return (int)i;
+  return -1;
+}
+
+String String::substring(unsigned int from, unsigned int to) const {
+  if (to > len) to = len;
+  if (from > to) from = to;
+  String result;
+  result.concat(c_str() + from, to - from);
+  return result;
+}
@@ -0,0 +1,71 @@
+/**
+ * The Flying Squirrels: Squirrel Lighting Controller
+ * Purpose: Host build shim, Arduino String on top of a heap character buffer.
+ *          Allocation behavior mirrors the core closely enough that the heap
+ *          counters in the benchmarks reflect what the device would do.
+ * Date:    2026-10-17
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+class String {
+public:
+  String(const char* value = "");
+  String(const String&);
+  String(char);
+  String(int, unsigned char base = 10);
+  String(unsigned int, unsigned char base = 10);
+  String(long, unsigned char base = 10);
+  String(unsigned long, unsigned char base = 10);
+  String(unsigned char, unsigned char base = 10);
+  String(float, unsigned char decimals = 2);
+  String(double, unsigned char decimals = 2);
+  ~String();
+
+  String& operator=(const String&);
+  String& operator=(const char*);
+  String& operator+=(const String& other) { concat(other.c_str(), other.len); return *this; }
+  String& operator+=(const char* other) { concat(other, strlenSafe(other)); return *this; }
+  String& operator+=(char);
+  String& operator+=(int value) { return *this += String(value); }
+  String& operator+=(unsigned char value) { return *this += String(value); }
+  String& operator+=(long value) { return *this += String(value); }
+
+  friend String operator+(const String&, const String&);
+  friend String operator+(const String&, const char*);
+  friend String operator+(const String&, char);
+
+  char operator[](unsigned int index) const { return index < len ? buffer[index] : 0; }
+  char& operator[](unsigned int index);
+  bool operator==(const String& other) const { return equals(other); }
+  bool operator==(const char* other) const { return equals(other); }
+  bool operator!=(const String& other) const { return !equals(other); }
+
+  const char* c_str() const { return buffer ? buffer : ""; }
+  unsigned int length() const { return len; }
+  bool equals(const String&) const;
+  bool equals(const char*) const;
+  bool startsWith(const char* prefix) const { return strncmp(c_str(), prefix, strlen(prefix)) == 0; }
+  bool startsWith(const String& prefix) const { return startsWith(prefix.c_str()); }
+  void replace(const char* find, const char* replacement);
+  long toInt() const;
+  float toFloat() const;
+  void trim();
+  int indexOf(char, unsigned int from = 0) const;
+  String substring(unsigned int, unsigned int) const;
+  String substring(unsigned int from) const { return substring(from, len); }
+  bool reserve(unsigned int);
+  void concat(const char*, size_t);
+  void remove(unsigned int index) { remove(index, len); }
+  void remove(unsigned int, unsigned int);
+
+private:
+  static size_t strlenSafe(const char*);
+  void assign(const char*, size_t);
+
+  char* buffer = nullptr;
+  unsigned int capacity = 0;
+  unsigned int len = 0;
+};
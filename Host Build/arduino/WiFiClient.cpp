@@ -0,0 +1,220 @@
+/**
+ * The Flying Squirrels: Squirrel Lighting Controller
+ * Purpose: Host build shim, WiFiClient and WiFiServer over loopback TCP
+ * Date:    2026-10-17
+ */
+
+#include "WiFiClient.h"
+#include "WiFiServer.h"
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+
+WiFiClient::WiFiClient() {}
+
+WiFiClient::WiFiClient(const WiFiClient& other) : context(other.context), peeked(other.peeked) {
+  if (context)
+    context->references++;
+}
+
+WiFiClient& WiFiClient::operator=(const WiFiClient& other) {
+  if (this != &other) {
+    release();
+    context = other.context;
+    peeked = other.peeked;
+    if (context)
+      context->references++;
+  }
+  return *this;
+}
+
+WiFiClient::~WiFiClient() {
+  release();
+}
+
+void WiFiClient::release() {
+  if (context && --context->references == 0) {
+    if (context->socketFd >= 0)
+      close(context->socketFd);
+    delete context;
+  }
+  context = nullptr;
+}
+
+WiFiClient WiFiClient::fromSocket(int socketFd) {
+  WiFiClient client;
+  fcntl(socketFd, F_SETFL, fcntl(socketFd, F_GETFL) | O_NONBLOCK);
+  int enable = 1;
+  setsockopt(socketFd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+  client.context = new Context{socketFd, 1, false};
+  return client;
+}
+
+int WiFiClient::connect(IPAddress address, uint16_t port) {
+  release();
+  int socketFd = socket(AF_INET, SOCK_STREAM, 0);
+  if (socketFd < 0)
+    return 0;
+  fcntl(socketFd, F_SETFL, fcntl(socketFd, F_GETFL) | O_NONBLOCK);
+  int enable = 1;
+  setsockopt(socketFd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+
+  sockaddr_in local = {};
+  local.sin_family = AF_INET;
+  local.sin_addr.s_addr = HostNet::toLoopback(HostNet::getLocalAddress());
+  bind(socketFd, (sockaddr*)&local, sizeof(local));
+
+  sockaddr_in remote = {};
+  remote.sin_family = AF_INET;
+  remote.sin_port = htons(port);
+  remote.sin_addr.s_addr = HostNet::toLoopback(address);
+  int result = ::connect(socketFd, (sockaddr*)&remote, sizeof(remote));
+  if (result != 0 && errno != EINPROGRESS) {
+    close(socketFd);
+    return 0;
+  }
+  context = new Context{socketFd, 1, result != 0};
+  return 1;
+}
+
+uint8_t WiFiClient::connected() {
+  if (!context || context->socketFd < 0)
+    return 0;
+  if (context->connecting) {
+    struct pollfd fd = {context->socketFd, POLLOUT, 0};
+    if (poll(&fd, 1, 0) <= 0)
+      return 0;
+    int error = 0;
+    socklen_t length = sizeof(error);
+    getsockopt(context->socketFd, SOL_SOCKET, SO_ERROR, &error, &length);
+    if (error != 0)
+      return 0;
+    context->connecting = false;
+  }
+  if (peeked >= 0)
+    return 1;
+  char probe;
+  ssize_t result = recv(context->socketFd, &probe, 1, MSG_PEEK | MSG_DONTWAIT);
+  if (result == 0)
+    return 0;
+  if (result < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+    return 0;
+  return 1;
+}
+
+void WiFiClient::stop() {
+  if (context && context->socketFd >= 0) {
+    close(context->socketFd);
+    context->socketFd = -1;
+  }
+  peeked = -1;
+}
+
+int WiFiClient::available() {
+  if (!context || context->socketFd < 0 || context->connecting)
+    return peeked >= 0 ? 1 : 0;
+  int count = 0;
+  char buffer[512];
+  ssize_t result = recv(context->socketFd, buffer, sizeof(buffer), MSG_PEEK | MSG_DONTWAIT);
+  if (result > 0)
+    count = (int)result;
+  return count + (peeked >= 0 ? 1 : 0);
+}
+
+int WiFiClient::read() {
+  if (peeked >= 0) {
+    int value = peeked;
+    peeked = -1;
+    return value;
+  }
+  unsigned char value;
+  return read(&value, 1) == 1 ? value : -1;
+}
+
+int WiFiClient::read(uint8_t* buffer, size_t size) {
+  if (!context || context->socketFd < 0 || !size)
+    return -1;
+  size_t offset = 0;
+  if (peeked >= 0) {
+    buffer[offset++] = (uint8_t)peeked;
+    peeked = -1;
+  }
+  ssize_t result = recv(context->socketFd, buffer + offset, size - offset, MSG_DONTWAIT);
+  if (result > 0)
+    offset += result;
+  return offset > 0 ? (int)offset : -1;
+}
+
+int WiFiClient::peek() {
+  if (peeked < 0)
+    peeked = read();
+  return peeked;
+}
+
+size_t WiFiClient::write(const uint8_t* buffer, size_t size) {
+  if (!connected())
+    return 0;
+  size_t written = 0;
+  while (written < size) {
+    ssize_t result = send(context->socketFd, buffer + written, size - written, MSG_NOSIGNAL);
+    if (result > 0)
+      written += result;
+    else if (result < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+      break;
+  }
+  return written;
+}
+
+IPAddress WiFiClient::remoteIP() {
+  sockaddr_in remote = {};
+  socklen_t length = sizeof(remote);
+  if (!context || getpeername(context->socketFd, (sockaddr*)&remote, &length) != 0)
+    return IPAddress();
+  return HostNet::fromLoopback(remote.sin_addr.s_addr);
+}
+
+uint16_t WiFiClient::remotePort() {
+  sockaddr_in remote = {};
+  socklen_t length = sizeof(remote);
+  if (!context || getpeername(context->socketFd, (sockaddr*)&remote, &length) != 0)
+    return 0;
+  return ntohs(remote.sin_port);
+}
+
+void WiFiServer::begin() {
+  close();
+  socketFd = socket(AF_INET, SOCK_STREAM, 0);
+  if (socketFd < 0)
+    return;
+  int enable = 1;
+  setsockopt(socketFd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+  fcntl(socketFd, F_SETFL, fcntl(socketFd, F_GETFL) | O_NONBLOCK);
+  sockaddr_in local = {};
+  local.sin_family = AF_INET;
+  local.sin_port = htons(port);
+  local.sin_addr.s_addr = HostNet::toLoopback(HostNet::getLocalAddress());
+  if (bind(socketFd, (sockaddr*)&local, sizeof(local)) != 0 || listen(socketFd, 16) != 0) {
+    ::close(socketFd);
+    socketFd = -1;
+  }
+}
+
+void WiFiServer::close() {
+  if (socketFd >= 0)
+    ::close(socketFd);
+  socketFd = -1;
+}
+
+WiFiClient WiFiServer::available() {
+  if (socketFd < 0)
+    return WiFiClient();
+  int accepted = accept(socketFd, nullptr, nullptr);
+  if (accepted < 0)
+    return WiFiClient();
+  return WiFiClient::fromSocket(accepted);
+}
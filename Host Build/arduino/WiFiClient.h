@@ -0,0 +1,54 @@
+/**
+ * The Flying Squirrels: Squirrel Lighting Controller
+ * Purpose: Host build shim, WiFiClient over non-blocking loopback TCP. Copies
+ *          share the connection, like the core's reference-counted client
+ *          context.
+ * Date:    2026-10-17
+ */
+
+#pragma once
+
+#include "Arduino.h"
+#include "HostNet.h"
+
+class WiFiClient : public Stream {
+public:
+  WiFiClient();
+  WiFiClient(const WiFiClient&);
+  WiFiClient& operator=(const WiFiClient&);
+  virtual ~WiFiClient();
+
+  int connect(IPAddress address, uint16_t port);
+  uint8_t connected();
+  void stop();
+  operator bool() { return context != nullptr; }
+
+  virtual int available();
+  virtual int read();
+  int read(uint8_t* buffer, size_t size);
+  virtual int peek();
+  virtual void flush() {}
+  virtual size_t write(uint8_t value) { return write(&value, 1); }
+  virtual size_t write(const uint8_t* buffer, size_t size);
+  using Print::write;
+
+  void setNoDelay(bool) {}
+  IPAddress remoteIP();
+  uint16_t remotePort();
+
+  //Used by WiFiServer to wrap an accepted socket
+  static WiFiClient fromSocket(int socketFd);
+
+private:
+  struct Context {
+    int socketFd;
+    int references;
+    bool connecting;
+  };
+
+  void release();
+  void fill();
+
+  Context* context = nullptr;
+  int peeked = -1;
+};
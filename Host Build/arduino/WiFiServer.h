@@ -0,0 +1,24 @@
+/**
+ * The Flying Squirrels: Squirrel Lighting Controller
+ * Purpose: Host build shim, listening TCP socket bound to the current node
+ *          address.
+ * Date:    2026-10-17
+ */
+
+#pragma once
+
+#include "WiFiClient.h"
+
+class WiFiServer {
+public:
+  WiFiServer(uint16_t port) : port(port) {}
+  ~WiFiServer() { close(); }
+
+  void begin();
+  void close();
+  WiFiClient available();
+
+private:
+  uint16_t port;
+  int socketFd = -1;
+};
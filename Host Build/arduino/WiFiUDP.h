@@ -0,0 +1,9 @@
+/**
+ * The Flying Squirrels: Squirrel Lighting Controller
+ * Purpose: Host build shim, alternate spelling used by some includes
+ * Date:    2026-10-17
+ */
+
+#pragma once
+
+#include "WiFiUdp.h"
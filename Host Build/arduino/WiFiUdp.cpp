@@ -0,0 +1,141 @@
+/**
+ * The Flying Squirrels: Squirrel Lighting Controller
+ * Purpose: Host build shim, WiFiUDP over loopback datagram sockets
+ * Date:    2026-10-17
+ */
+
+#include "WiFiUdp.h"
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace HostNet {
+  void countSend(size_t bytes);
+  bool loseDatagram();
+}
+
+uint8_t WiFiUDP::begin(uint16_t port) {
+  stop();
+  socketFd = socket(AF_INET, SOCK_DGRAM, 0);
+  if (socketFd < 0)
+    return 0;
+  int enable = 1;
+  setsockopt(socketFd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+  fcntl(socketFd, F_SETFL, fcntl(socketFd, F_GETFL) | O_NONBLOCK);
+
+  boundAddress = HostNet::getLocalAddress();
+  sockaddr_in local = {};
+  local.sin_family = AF_INET;
+  local.sin_port = htons(port);
+  local.sin_addr.s_addr = HostNet::toLoopback(boundAddress);
+  if (bind(socketFd, (sockaddr*)&local, sizeof(local)) != 0) {
+    close(socketFd);
+    socketFd = -1;
+    return 0;
+  }
+  boundPort = port;
+  HostNet::registerBinding(boundAddress, port);
+  return 1;
+}
+
+void WiFiUDP::stop() {
+  if (socketFd >= 0) {
+    close(socketFd);
+    HostNet::unregisterBinding(boundAddress, boundPort);
+  }
+  socketFd = -1;
+  boundPort = 0;
+  rxLength = rxIndex = 0;
+}
+
+int WiFiUDP::parsePacket() {
+  rxLength = rxIndex = 0;
+  if (socketFd < 0)
+    return 0;
+  sockaddr_in remote = {};
+  socklen_t remoteLength = sizeof(remote);
+  ssize_t received = recvfrom(socketFd, rxBuffer, sizeof(rxBuffer), 0,
+      (sockaddr*)&remote, &remoteLength);
+  if (received <= 0)
+    return 0;
+  rxLength = (int)received;
+  remoteAddress = HostNet::fromLoopback(remote.sin_addr.s_addr);
+  remotePortNumber = ntohs(remote.sin_port);
+  return rxLength;
+}
+
+int WiFiUDP::read() {
+  return rxIndex < rxLength ? (unsigned char)rxBuffer[rxIndex++] : -1;
+}
+
+int WiFiUDP::read(unsigned char* buffer, size_t length) {
+  size_t count = (size_t)(rxLength - rxIndex);
+  if (count > length)
+    count = length;
+  memcpy(buffer, rxBuffer + rxIndex, count);
+  rxIndex += (int)count;
+  return (int)count;
+}
+
+int WiFiUDP::beginPacket(IPAddress address, uint16_t port) {
+  txAddress = address;
+  txPort = port;
+  txLength = 0;
+  txOpen = true;
+  return 1;
+}
+
+int WiFiUDP::beginPacket(const char* host, uint16_t port) {
+  IPAddress address;
+  if (!address.fromString(host))
+    return 0;
+  return beginPacket(address, port);
+}
+
+size_t WiFiUDP::write(const uint8_t* buffer, size_t size) {
+  if (!txOpen)
+    return 0;
+  if (size > (size_t)(MAX_DATAGRAM - txLength))
+    size = MAX_DATAGRAM - txLength;
+  memcpy(txBuffer + txLength, buffer, size);
+  txLength += (int)size;
+  return size;
+}
+
+int WiFiUDP::endPacket() {
+  if (!txOpen)
+    return 0;
+  txOpen = false;
+
+  //Lazily open an ephemeral socket when sending without begin()
+  if (socketFd < 0) {
+    socketFd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (socketFd < 0)
+      return 0;
+    fcntl(socketFd, F_SETFL, fcntl(socketFd, F_GETFL) | O_NONBLOCK);
+    sockaddr_in local = {};
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = HostNet::toLoopback(HostNet::getLocalAddress());
+    bind(socketFd, (sockaddr*)&local, sizeof(local));
+  }
+
+  IPAddress targets[64];
+  int targetCount = 1;
+  targets[0] = txAddress;
+  if (txAddress[3] == 255)
+    targetCount = HostNet::getBindings(txPort, targets, 64);
+
+  for (int i = 0; i < targetCount; i++) {
+    if (HostNet::loseDatagram())
+      continue;
+    sockaddr_in remote = {};
+    remote.sin_family = AF_INET;
+    remote.sin_port = htons(txPort);
+    remote.sin_addr.s_addr = HostNet::toLoopback(targets[i]);
+    sendto(socketFd, txBuffer, txLength, 0, (sockaddr*)&remote, sizeof(remote));
+  }
+  HostNet::countSend(txLength);
+  return 1;
+}
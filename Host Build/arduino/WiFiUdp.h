@@ -0,0 +1,54 @@
+/**
+ * The Flying Squirrels: Squirrel Lighting Controller
+ * Purpose: Host build shim, WiFiUDP over non-blocking loopback datagram sockets
+ * Date:    2026-10-17
+ */
+
+#pragma once
+
+#include "Arduino.h"
+#include "HostNet.h"
+
+class WiFiUDP : public Stream {
+public:
+  WiFiUDP() {}
+  ~WiFiUDP() { stop(); }
+
+  uint8_t begin(uint16_t port);
+  void stop();
+  uint16_t localPort() const { return boundPort; }
+
+  int parsePacket();
+  virtual int available() { return rxLength - rxIndex; }
+  virtual int read();
+  int read(unsigned char* buffer, size_t length);
+  int read(char* buffer, size_t length) { return read((unsigned char*)buffer, length); }
+  virtual int peek() { return rxIndex < rxLength ? (unsigned char)rxBuffer[rxIndex] : -1; }
+  virtual void flush() { rxIndex = rxLength; }
+  IPAddress remoteIP() const { return remoteAddress; }
+  uint16_t remotePort() const { return remotePortNumber; }
+
+  int beginPacket(IPAddress address, uint16_t port);
+  int beginPacket(const char* host, uint16_t port);
+  int endPacket();
+  virtual size_t write(uint8_t value) { return write(&value, 1); }
+  virtual size_t write(const uint8_t* buffer, size_t size);
+  using Print::write;
+
+private:
+  static const int MAX_DATAGRAM = 1472;
+
+  int socketFd = -1;
+  uint16_t boundPort = 0;
+  IPAddress boundAddress;
+  char rxBuffer[MAX_DATAGRAM];
+  int rxLength = 0;
+  int rxIndex = 0;
+  IPAddress remoteAddress;
+  uint16_t remotePortNumber = 0;
+  char txBuffer[MAX_DATAGRAM];
+  int txLength = 0;
+  IPAddress txAddress;
+  uint16_t txPort = 0;
+  bool txOpen = false;
+};
@@ -0,0 +1,38 @@
+/**
+ * The Flying Squirrels: Squirrel Lighting Controller
+ * Purpose: Host build shim, TwoWire mock answering like a PCF8591
+ * Date:    2026-10-17
+ */
+
+#include "Wire.h"
+
+TwoWire Wire;
+
+//The PCF8591 answers with the previous conversion first, then each input
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity) {
+  lastAddress = address;
+  responseIndex = 0;
+  responseLength = quantity > sizeof(responseData) ? sizeof(responseData) : quantity;
+  uint8_t channel = writeCount > 0 ? (written[0] & 0x03) : 0;
+  bool autoIncrement = writeCount > 0 && (written[0] & 0x04);
+  responseData[0] = 0x80;
+  for (uint8_t i = 1; i < responseLength; i++) {
+    responseData[i] = inputs[channel];
+    if (autoIncrement)
+      channel = (channel + 1) & 0x03;
+  }
+  return responseLength;
+}
+
+size_t TwoWire::write(uint8_t value) {
+  if (writeCount < sizeof(written))
+    written[writeCount++] = value;
+  return 1;
+}
+
+void TwoWire::setInputs(uint8_t a0, uint8_t a1, uint8_t a2, uint8_t a3) {
+  inputs[0] = a0;
+  inputs[1] = a1;
+  inputs[2] = a2;
+  inputs[3] = a3;
+}
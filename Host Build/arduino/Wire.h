@@ -0,0 +1,43 @@
+/**
+ * The Flying Squirrels: Squirrel Lighting Controller
+ * Purpose: Host build shim, TwoWire mock. Reads are served from a programmable
+ *          response queue and writes are recorded for inspection.
+ * Date:    2026-10-17
+ */
+
+#pragma once
+
+#include "Arduino.h"
+
+class TwoWire : public Stream {
+public:
+  void begin(int = 0, int = 0) {}
+  void beginTransmission(uint8_t address) { lastAddress = address; writeCount = 0; }
+  uint8_t endTransmission() { return 0; }
+  uint8_t requestFrom(uint8_t address, uint8_t quantity);
+  uint8_t requestFrom(int address, int quantity) { return requestFrom((uint8_t)address, (uint8_t)quantity); }
+  uint8_t requestFrom(uint8_t address, int quantity) { return requestFrom(address, (uint8_t)quantity); }
+
+  virtual int available() { return responseLength - responseIndex; }
+  virtual int read() { return responseIndex < responseLength ? responseData[responseIndex++] : -1; }
+  virtual int peek() { return responseIndex < responseLength ? responseData[responseIndex] : -1; }
+  virtual void flush() {}
+  virtual size_t write(uint8_t value);
+  using Print::write;
+
+  //Mock controls: values returned for the analog inputs of any chip
+  void setInputs(uint8_t a0, uint8_t a1, uint8_t a2, uint8_t a3);
+  uint8_t getLastAddress() const { return lastAddress; }
+  uint8_t getLastWrite(int index) const { return index < writeCount ? written[index] : 0; }
+
+private:
+  uint8_t inputs[4] = {0, 0, 0, 0};
+  uint8_t responseData[8];
+  uint8_t responseLength = 0;
+  uint8_t responseIndex = 0;
+  uint8_t written[8];
+  uint8_t writeCount = 0;
+  uint8_t lastAddress = 0;
+};
+
+extern TwoWire Wire;
@@ -0,0 +1,89 @@
+/**
+ * The Flying Squirrels: Squirrel Lighting Controller
+ * Purpose: Host build shim, timing, randomness, ESP and Serial
+ * Date:    2026-10-17
+ */
+
+#include "Arduino.h"
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+
+EspClass ESP;
+HardwareSerial Serial;
+
+static uint64_t monotonicNanos() {
+  static uint64_t start = 0;
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  uint64_t nanos = (uint64_t)now.tv_sec * 1000000000ull + now.tv_nsec;
+  if (!start)
+    start = nanos;
+  return nanos - start;
+}
+
+unsigned long millis() { return (unsigned long)(uint32_t)(monotonicNanos() / 1000000ull); }
+unsigned long micros() { return (unsigned long)(uint32_t)(monotonicNanos() / 1000ull); }
+
+void delay(unsigned long ms) {
+  struct timespec span = {(time_t)(ms / 1000), (long)(ms % 1000) * 1000000l};
+  nanosleep(&span, nullptr);
+}
+
+void delayMicroseconds(unsigned int us) {
+  struct timespec span = {(time_t)(us / 1000000), (long)(us % 1000000) * 1000l};
+  nanosleep(&span, nullptr);
+}
+
+void yield() {}
+
+long random(long upper) { return upper > 0 ? rand() % upper : 0; }
+long random(long lower, long upper) { return upper > lower ? lower + random(upper - lower) : lower; }
+void randomSeed(unsigned long seed) { srand((unsigned)seed); }
+
+//Emulate the 80MHz CCOUNT register from the monotonic clock
+uint32_t EspClass::getCycleCount() {
+  return (uint32_t)(monotonicNanos() * 80ull / 1000ull);
+}
+
+uint32_t EspClass::getFreeHeap() { return 40 * 1024; }
+
+int HardwareSerial::available() {
+  if (peeked >= 0)
+    return 1;
+  struct pollfd fd = {0, POLLIN, 0};
+  return poll(&fd, 1, 0) > 0 && (fd.revents & POLLIN) ? 1 : 0;
+}
+
+int HardwareSerial::read() {
+  if (peeked >= 0) {
+    int value = peeked;
+    peeked = -1;
+    return value;
+  }
+  if (!available())
+    return -1;
+  unsigned char c;
+  return ::read(0, &c, 1) == 1 ? c : -1;
+}
+
+int HardwareSerial::peek() {
+  if (peeked < 0)
+    peeked = read();
+  return peeked;
+}
+
+void HardwareSerial::flush() { fflush(stdout); }
+
+size_t HardwareSerial::write(uint8_t value) {
+  if (!quiet)
+    fputc(value, stdout);
+  return 1;
+}
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size) {
+  if (!quiet)
+    fwrite(buffer, 1, size, stdout);
+  return size;
+}
@@ -0,0 +1,16 @@
+/**
+ * The Flying Squirrels: Squirrel Lighting Controller
+ * Purpose: Host build shim, soft AP configuration stubs from the ESP SDK
+ * Date:    2026-10-17
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+struct softap_config {
+  uint8_t max_connection;
+};
+
+inline bool wifi_softap_get_config(struct softap_config*) { return true; }
+inline bool wifi_softap_set_config(struct softap_config*) { return true; }
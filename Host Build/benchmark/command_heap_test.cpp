@@ -0,0 +1,14 @@
+/**
+ * The Flying Squirrels: Squirrel Lighting Controller
+ * Purpose: Runs the command heap test sketch on the host, where HostHeap
+ *          counts its allocations
+ * Date:    2026-10-17
+ */
+
+#include <Arduino.h>
+#include "sketch_command_heap_test.ino"
+
+int main() {
+  setup();
+  return 0;
+}
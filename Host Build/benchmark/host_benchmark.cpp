@@ -0,0 +1,505 @@
+/**
+ * The Flying Squirrels: Squirrel Lighting Controller
+ * Purpose: Host benchmark for command handling and color conversion
+ * Date:    2026-10-17
+ */
+
+#include <atomic>
+#include <thread>
+#include <Arduino.h>
+#include <HostHeap.h>
+#include <HostNet.h>
+#include <CommandInterpreter.h>
+#include <LumenFrame.h>
+#include <TcpClientRegistrar.h>
+#include <UdpStream.h>
+#include "Helpers.h"
+
+const int PACKET_SIZE = 512;
+const int SERIAL_ROUNDS = 200;
+const int UDP_COMMANDS = 20000;
+const int UDP_PORT = 5000;
+const int STREAM_PORT = 5001;
+const int RELIABLE_PORT = 5002;
+const int RELIABLE_COMMANDS = 5000;
+const int COALESCE_PORT = 5003;
+const int COALESCE_BURSTS = 2000;
+const int COALESCE_BURST_SIZE = 4;
+const int JOIN_PORT = 5004;
+const int JOIN_NODES = 16;
+const int FRAME_SLOTS = 16;
+const int FRAME_COUNT = 200000;
+const int COLOR_CONVERSIONS = 2000000;
+
+/**
+ * Serves a block of command text in packets, checking for the next packet
+ * on every call like UdpStream does. Replies are counted and dropped.
+ */
+class PacketStream : public Stream {
+public:
+  PacketStream(const char* data, int length) : data(data), length(length) {}
+  int available() { nextPacket(); return packetEnd - position; }
+  int read() { nextPacket(); return position < packetEnd ? data[position++] : -1; }
+  int peek() { nextPacket(); return position < packetEnd ? data[position] : -1; }
+  void flush() {}
+  size_t write(uint8_t) { replyBytes++; return 1; }
+  size_t write(const uint8_t*, size_t size) { replyBytes += size; return size; }
+  size_t readBytes(char* buffer, size_t size) {
+    nextPacket();
+    size_t count = packetEnd - position;
+    count = size < count ? size : count;
+    memcpy(buffer, &data[position], count);
+    position += count;
+    return count;
+  }
+  void rewind() { position = 0; packetEnd = 0; }
+  bool done() { return position >= length; }
+  unsigned long replyBytes = 0;
+
+private:
+  void nextPacket() {
+    if (position >= packetEnd && position < length)
+      packetEnd = position + PACKET_SIZE < length ? position + PACKET_SIZE : length;
+  }
+  const char* data;
+  int length;
+  int position = 0;
+  int packetEnd = 0;
+};
+
+unsigned long handledCount = 0;
+
+void commandColor(Stream& port, int, const CommandInterpreter::Argument*) {
+  handledCount++;
+  port.print("OK\n");
+}
+
+void commandText(Stream& port, int argc, const char**) {
+  handledCount++;
+  port.printf("%i args\n", argc);
+}
+
+void assignCommands(CommandInterpreter& interpreter) {
+  interpreter.assign("c", commandColor, "u8 u8 u8 u8");
+  interpreter.assign("t", commandColor, "u8 u8");
+  interpreter.assign("debug", commandText);
+}
+
+double perSecond(double count, uint32_t elapsedMicros) {
+  return count * 1000000.0 / (elapsedMicros ? elapsedMicros : 1);
+}
+
+/**
+ * Feeds the same block of serial commands through handle() repeatedly.
+ */
+void benchmarkSerial(const char* name, const char** lines, int lineKinds) {
+
+  //Build a block of commands from the given lines
+  const int LINE_COUNT = 1000;
+  int length = 0;
+  for (int i = 0; i < LINE_COUNT; i++)
+    length += strlen(lines[i % lineKinds]);
+  char* text = (char*)malloc(length + 1);
+  char* end = text;
+  for (int i = 0; i < LINE_COUNT; i++)
+    end += sprintf(end, "%s", lines[i % lineKinds]);
+  PacketStream stream(text, length);
+
+  CommandInterpreter interpreter;
+  assignCommands(interpreter);
+  interpreter.setBudget(8);
+  handledCount = 0;
+
+  uint32_t allocations = HostHeap::allocations();
+  uint32_t start = micros();
+  for (int round = 0; round < SERIAL_ROUNDS; round++) {
+    stream.rewind();
+    while (!stream.done())
+      interpreter.handle(stream);
+    while (handledCount < (unsigned long)(round + 1) * LINE_COUNT)
+      interpreter.handle(stream);
+  }
+  uint32_t elapsed = micros() - start;
+  allocations = HostHeap::allocations() - allocations;
+
+  Serial.printf("serial %s: %lu commands, %lu bytes\n", name, handledCount,
+      (unsigned long)length * SERIAL_ROUNDS);
+  Serial.printf("  %12.0f commands/sec\n", perSecond(handledCount, elapsed));
+  Serial.printf("  %12.0f bytes parsed/sec\n", perSecond((double)length * SERIAL_ROUNDS, elapsed));
+  Serial.printf("  %12.3f heap allocations/command\n", (double)allocations / handledCount);
+  free(text);
+}
+
+/**
+ * Sends single command datagrams over loopback to an interpreter bound like
+ * a node would be, and reads back each reply.
+ */
+void benchmarkUdp() {
+  IPAddress nodeAddress(192, 168, 3, 20);
+  IPAddress clientAddress(192, 168, 3, 21);
+
+  HostNet::setLocalAddress(nodeAddress);
+  WiFiUDP nodePort;
+  if (!nodePort.begin(UDP_PORT)) {
+    Serial.print("udp: could not bind loopback port, skipped\n");
+    return;
+  }
+  HostNet::setLocalAddress(clientAddress);
+  WiFiUDP clientPort;
+  clientPort.begin(UDP_PORT);
+
+  CommandInterpreter interpreter;
+  assignCommands(interpreter);
+  handledCount = 0;
+
+  const char* COMMAND = "c 255 128 0 64\n";
+  int length = strlen(COMMAND);
+  unsigned long replies = 0;
+
+  uint32_t allocations = HostHeap::allocations();
+  uint32_t start = micros();
+  for (int i = 0; i < UDP_COMMANDS; i++) {
+    clientPort.beginPacket(nodeAddress, UDP_PORT);
+    clientPort.write((const uint8_t*)COMMAND, length);
+    clientPort.endPacket();
+    interpreter.handleUdp(nodePort);
+    if (clientPort.parsePacket() > 0)
+      replies++;
+  }
+  uint32_t elapsed = micros() - start;
+  allocations = HostHeap::allocations() - allocations;
+
+  Serial.printf("udp loopback: %lu commands, %lu replies\n", handledCount, replies);
+  Serial.printf("  %12.0f commands/sec (including socket round trip)\n", perSecond(handledCount, elapsed));
+  Serial.printf("  %12.3f heap allocations/command\n",
+      handledCount ? (double)allocations / handledCount : 0.0);
+}
+
+/**
+ * Sends numbered datagrams of two commands each to a UdpStream server, read
+ * by handle() like io_control reads the squirrel.
+ */
+void benchmarkUdpStream() {
+  IPAddress nodeAddress(192, 168, 3, 22);
+  IPAddress clientAddress(192, 168, 3, 23);
+
+  HostNet::setLocalAddress(nodeAddress);
+  UdpStream nodeStream;
+  if (!nodeStream.begin(STREAM_PORT)) {
+    Serial.print("udp stream: could not bind loopback port, skipped\n");
+    return;
+  }
+  HostNet::setLocalAddress(clientAddress);
+  WiFiUDP clientPort;
+  clientPort.begin(STREAM_PORT);
+
+  CommandInterpreter interpreter;
+  assignCommands(interpreter);
+  handledCount = 0;
+
+  const char* COMMANDS = "c 255 128 0 64\nt 200 180\n";
+  int length = strlen(COMMANDS);
+
+  uint32_t allocations = HostHeap::allocations();
+  uint32_t start = micros();
+  for (int i = 1; i <= UDP_COMMANDS / 2; i++) {
+    clientPort.beginPacket(nodeAddress, STREAM_PORT);
+    clientPort.printf("%i\r\r", i);
+    clientPort.write((const uint8_t*)COMMANDS, length);
+    clientPort.endPacket();
+    interpreter.handle(nodeStream);
+    interpreter.handle(nodeStream);
+    nodeStream.flush();
+    while (clientPort.parsePacket() > 0);
+  }
+  uint32_t elapsed = micros() - start;
+  allocations = HostHeap::allocations() - allocations;
+
+  Serial.printf("udp stream loopback: %lu commands\n", handledCount);
+  Serial.printf("  %12.0f commands/sec (including socket round trip)\n", perSecond(handledCount, elapsed));
+  Serial.printf("  %12.3f heap allocations/command\n",
+      handledCount ? (double)allocations / handledCount : 0.0);
+}
+
+/**
+ * Runs a reliable UdpStream pair in one loop, the client sending a command per
+ * flush and reading the replies, with the given share of datagrams dropped.
+ */
+void benchmarkReliable(int lossPercent) {
+  IPAddress nodeAddress(192, 168, 3, 24);
+  IPAddress clientAddress(192, 168, 3, 25);
+
+  HostNet::setLocalAddress(nodeAddress);
+  UdpStream nodeStream;
+  nodeStream.enableReliable(true);
+  if (!nodeStream.begin(RELIABLE_PORT)) {
+    Serial.print("reliable udp stream: could not bind loopback port, skipped\n");
+    return;
+  }
+  HostNet::setLocalAddress(clientAddress);
+  UdpStream clientStream;
+  clientStream.enableReliable(true);
+  clientStream.begin(nodeAddress, RELIABLE_PORT);
+
+  //The sync completes while both ends poll
+  uint32_t syncStart = millis();
+  while (clientStream.getState() == UdpStream::CONNECTING && millis() - syncStart < 2000)
+    nodeStream.available();
+  if (!clientStream.connected()) {
+    Serial.print("reliable udp stream: sync failed, skipped\n");
+    return;
+  }
+
+  CommandInterpreter interpreter;
+  assignCommands(interpreter);
+  handledCount = 0;
+  unsigned long replies = 0;
+  uint32_t lost = HostNet::datagramsLost();
+  HostNet::setLossPercent(lossPercent);
+
+  int sent = 0;
+  uint32_t start = micros();
+  uint32_t startMillis = millis();
+  while (replies < (unsigned long)RELIABLE_COMMANDS && millis() - startMillis < 10000) {
+    //Keep a bounded number of commands in flight, as a sketch waiting on
+    //replies would
+    if (sent < RELIABLE_COMMANDS && sent - (long)replies < 32) {
+      clientStream.print("c 255 128 0 64\n");
+      clientStream.flush();
+      sent++;
+    }
+    //Handlers in the sketches flush their own replies
+    interpreter.handle(nodeStream);
+    nodeStream.flush();
+    while (clientStream.available() > 0)
+      if (clientStream.read() == '\n')
+        replies++;
+  }
+  uint32_t elapsed = micros() - start;
+  HostNet::setLossPercent(0);
+  lost = HostNet::datagramsLost() - lost;
+
+  Serial.printf("reliable udp stream, %i%% loss: %lu commands, %lu replies, %u datagrams lost\n",
+      lossPercent, handledCount, replies, lost);
+  Serial.printf("  %12.0f commands/sec (including socket round trip)\n", perSecond(handledCount, elapsed));
+  Serial.printf("  %12i retransmissions (client %i, node %i)\n",
+      clientStream.getRetransmitCount() + nodeStream.getRetransmitCount(),
+      clientStream.getRetransmitCount(), nodeStream.getRetransmitCount());
+}
+
+/**
+ * Sends bursts of one-line flushes from a UdpStream client, as io_control
+ * polls its sensors, with and without a coalescing window.
+ */
+void benchmarkCoalesce(uint32_t window) {
+  IPAddress nodeAddress(192, 168, 3, 26);
+  IPAddress clientAddress(192, 168, 3, 27);
+
+  HostNet::setLocalAddress(nodeAddress);
+  UdpStream nodeStream;
+  if (!nodeStream.begin(COALESCE_PORT)) {
+    Serial.print("coalesced udp stream: could not bind loopback port, skipped\n");
+    return;
+  }
+  HostNet::setLocalAddress(clientAddress);
+  UdpStream clientStream;
+  clientStream.begin(nodeAddress, COALESCE_PORT);
+  while (clientStream.getState() == UdpStream::CONNECTING)
+    nodeStream.available();
+  clientStream.setCoalesceWindow(window);
+
+  CommandInterpreter interpreter;
+  assignCommands(interpreter);
+  handledCount = 0;
+
+  int datagrams = clientStream.getSendCount();
+  uint32_t allocations = HostHeap::allocations();
+  uint32_t start = micros();
+  for (int burst = 0; burst < COALESCE_BURSTS; burst++) {
+    for (int i = 0; i < COALESCE_BURST_SIZE; i++) {
+      clientStream.print("t 200 180\n");
+      clientStream.flush();
+    }
+    //Polling the client sends anything still held once the window closes
+    unsigned long expected = (unsigned long)(burst + 1) * COALESCE_BURST_SIZE;
+    uint32_t waitStart = millis();
+    while (handledCount < expected && millis() - waitStart < 1000) {
+      clientStream.available();
+      interpreter.handle(nodeStream);
+      nodeStream.flush();
+    }
+  }
+  uint32_t elapsed = micros() - start;
+  datagrams = clientStream.getSendCount() - datagrams;
+  allocations = HostHeap::allocations() - allocations;
+
+  Serial.printf("udp stream, %u mS coalescing: %lu commands in %i datagrams, %i saved\n",
+      window, handledCount, datagrams, clientStream.getCoalescedCount());
+  Serial.printf("  %12.0f commands/sec (including the coalescing delay)\n", perSecond(handledCount, elapsed));
+  Serial.printf("  %12.3f heap allocations/command\n",
+      handledCount ? (double)allocations / handledCount : 0.0);
+}
+
+/**
+ * Registers simulated nodes with a hub, one after another as they would boot,
+ * by TCP handshake and by UDP announcement. The hub runs its loop on a thread
+ * of its own, because both ways of joining block the node until answered.
+ */
+void benchmarkJoin(bool announce) {
+  const char* name = announce ? "udp announce" : "tcp register";
+  IPAddress hubAddress(192, 168, 3, 1);
+
+  HostNet::setLocalAddress(hubAddress);
+  WiFiServer listenSocket(JOIN_PORT);
+  listenSocket.begin();
+  WiFiUDP announceSocket;
+  if (!announceSocket.begin(TcpClientRegistrar::ANNOUNCE_PORT)) {
+    Serial.printf("%s join: could not bind announce port %u, skipped\n",
+        name, TcpClientRegistrar::ANNOUNCE_PORT);
+    return;
+  }
+
+  TcpClientRegistrar registrar;
+  std::atomic<bool> running(true);
+  Serial.setQuiet(true);
+  std::thread hub([&]() {
+    while (running) {
+      registrar.handle(listenSocket);
+      registrar.handleAnnounce(announceSocket);
+      std::this_thread::yield();
+    }
+  });
+
+  int acknowledged = 0;
+  uint32_t total = 0, slowest = 0;
+  for (int i = 0; i < JOIN_NODES; i++) {
+    char identity[16];
+    snprintf(identity, sizeof(identity), "node-%i", i);
+    HostNet::setLocalAddress(IPAddress(192, 168, 3, 100 + i));
+
+    uint32_t start = micros();
+    bool registered;
+    if (announce) {
+      WiFiUDP nodeSocket;
+      nodeSocket.begin(TcpClientRegistrar::ANNOUNCE_PORT);
+      registered = TcpClientRegistrar::announce(
+          nodeSocket, IPAddress(192, 168, 3, 255), identity, 300);
+    } else {
+      WiFiClient nodeClient;
+      registered = TcpClientRegistrar::connectClient(
+          nodeClient, hubAddress, JOIN_PORT, identity, false);
+    }
+    uint32_t elapsed = micros() - start;
+
+    if (registered) {
+      acknowledged++;
+      total += elapsed;
+      slowest = elapsed > slowest ? elapsed : slowest;
+    }
+  }
+  //Let the hub finish reading the last identity
+  delay(50);
+  running = false;
+  hub.join();
+  Serial.setQuiet(false);
+
+  //Only count nodes the hub learned the right address for
+  int joined = 0;
+  for (int i = 0; i < JOIN_NODES; i++) {
+    char identity[16];
+    snprintf(identity, sizeof(identity), "node-%i", i);
+    if (registrar.findIp(identity) == IPAddress(192, 168, 3, 100 + i))
+      joined++;
+  }
+
+  Serial.printf("%s join: %i of %i nodes registered\n", name, joined, JOIN_NODES);
+  Serial.printf("  %12.3f mS average join latency, %.3f mS slowest\n",
+      acknowledged ? total / 1000.0 / acknowledged : 0.0, slowest / 1000.0);
+}
+
+volatile unsigned long frameChecksum = 0;
+
+/**
+ * Encodes io_control's lumen frames for 16 bulbs and decodes the last slot, as
+ * that bulb would. Frames either change every time (a color sweep) or repeat,
+ * which only costs the cached encoding.
+ */
+void benchmarkFrames(bool binary, bool animated) {
+  LumenFrame frame(1234);
+  frame.setSlotCount(FRAME_SLOTS);
+
+  unsigned long bytes = 0, decoded = 0;
+  uint32_t start = micros();
+  for (int i = 0; i < FRAME_COUNT; i++) {
+    uint8_t channels[3] = {uint8_t(animated ? i : 255), uint8_t(animated ? i >> 3 : 128), 64};
+    for (int slot = 0; slot < FRAME_SLOTS; slot++)
+      frame.set(slot, 'c', channels, 3);
+
+    int length;
+    const uint8_t* data = binary
+        ? frame.encodeBinary(length)
+        : (const uint8_t*)frame.encodeText(length);
+    bytes += length;
+
+    char command;
+    uint8_t values[LumenFrame::MAX_CHANNELS];
+    int count;
+    if (LumenFrame::decode(data, length, 1234, FRAME_SLOTS - 1, command, values, count)) {
+      decoded++;
+      frameChecksum += values[0] + values[1] + count;
+    }
+  }
+  uint32_t elapsed = micros() - start;
+
+  Serial.printf("%s frames, %s: %lu of %i decoded, %lu bytes/frame\n",
+      binary ? "binary" : "text", animated ? "changing" : "repeated",
+      decoded, FRAME_COUNT, bytes / FRAME_COUNT);
+  Serial.printf("  %12.0f nS/frame to set %i slots, encode and decode\n",
+      elapsed * 1000.0 / FRAME_COUNT, FRAME_SLOTS);
+}
+
+/**
+ * Converts a sweep of hues as the lumen nodes do for every color update.
+ */
+void benchmarkColor() {
+  uint8_t r, g, b;
+  unsigned long checksum = 0;
+  uint32_t start = micros();
+  for (int i = 0; i < COLOR_CONVERSIONS; i++) {
+    hsvToRgb((float)(i % 3600) / 10.0f, (float)(i % 101), 75.0f, r, g, b);
+    checksum += r + g + b;
+  }
+  uint32_t elapsed = micros() - start;
+
+  Serial.printf("hsvToRgb: %i conversions (checksum %lu)\n", COLOR_CONVERSIONS, checksum);
+  Serial.printf("  %12.0f conversions/sec\n", perSecond(COLOR_CONVERSIONS, elapsed));
+}
+
+int main() {
+  Serial.print("Host benchmark\n");
+
+  const char* SHORT_LINES[] = {"c 255 128 0 64\r\n", "t 200 180\n", "c 12 34 56 78\n", "t 255 0\r\n"};
+  benchmarkSerial("color commands", SHORT_LINES, 4);
+
+  const char* LONG_LINES[] = {
+    "debug lumen-1 reported a frame drop while the io controller was sending at thirty two "
+        "milliseconds per frame with a queue depth of four and retries disabled\n",
+    "debug lumen-2 reconnected to the squirrel after a beacon timeout\r\n"
+  };
+  benchmarkSerial("debug text", LONG_LINES, 2);
+
+  benchmarkUdp();
+  benchmarkUdpStream();
+  benchmarkReliable(0);
+  benchmarkReliable(10);
+  benchmarkCoalesce(0);
+  benchmarkCoalesce(2);
+  benchmarkJoin(false);
+  benchmarkJoin(true);
+  benchmarkFrames(false, true);
+  benchmarkFrames(false, false);
+  benchmarkFrames(true, true);
+  benchmarkFrames(true, false);
+  benchmarkColor();
+  return 0;
+}
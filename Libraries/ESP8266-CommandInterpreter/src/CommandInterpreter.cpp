@@ -7,30 +7,110 @@
 
 #include "CommandInterpreter.h"
 
+char CommandInterpreter::udpRequest[CommandInterpreter::UDP_PACKET_SIZE + 1];
+char CommandInterpreter::udpResponse[CommandInterpreter::UDP_PACKET_SIZE];
+
 CommandInterpreter::CommandInterpreter() {
 }
 
 /**
- * Clone registered command information, present a new buffer.
+ * Creates a session on a registry owned by the caller, which may be shared 
+ * by any number of interpreters. Only the line queue and counters are per
+ * session. Commands assigned through this interpreter go to the registry.
  */
-CommandInterpreter::CommandInterpreter(CommandInterpreter& toCopy) {
-  for (int i = 0; i < CMD_MAX_COUNT * (CMD_LENGTH + 1); i++)
-    cmdNames[i] = toCopy.cmdNames[i];
-  for (int i = 0; i < CMD_MAX_COUNT; i++)
-    cmdFunctions[i] = toCopy.cmdFunctions[i];
-  cmdFunctionDefault = toCopy.cmdFunctionDefault;
-  cmdCount = toCopy.cmdCount;
-  cmdPointer = 0;
+CommandInterpreter::CommandInterpreter(CommandRegistry& sharedRegistry) {
+  registry = &sharedRegistry;
+}
+
+/**
+ * Share registered command information, present a new buffer. The commands
+ * are copied only if either interpreter assigns more later.
+ */
+CommandInterpreter::CommandInterpreter(const CommandInterpreter& toCopy) {
+  registry = toCopy.registry;
+  if (registry != NULL && registry->references > 0)
+    registry->references++;
+  cmdBudget = toCopy.cmdBudget;
+  prefix = toCopy.prefix;
+}
+
+/**
+ * Share registered command information, start over with an empty buffer.
+ */
+CommandInterpreter& CommandInterpreter::operator=(const CommandInterpreter& toCopy) {
+  if (this == &toCopy)
+    return *this;
+  
+  releaseRegistry();
+  registry = toCopy.registry;
+  if (registry != NULL && registry->references > 0)
+    registry->references++;
+  cmdBudget = toCopy.cmdBudget;
   prefix = toCopy.prefix;
+  cmdLineCount = 0;
+  cmdLineStart = 0;
+  cmdPointer = 0;
+  cmdScan = 0;
+  cmdReceived = 0;
+  cmdDiscarding = false;
+  return *this;
+}
+
+CommandInterpreter::~CommandInterpreter() {
+  releaseRegistry();
+}
+
+/**
+ * Gets a registry that is safe to assign to. A registry this interpreter 
+ * shares with copies of itself is copied first (copy on write).
+ */
+CommandRegistry* CommandInterpreter::writableRegistry() {
+  if (registry == NULL) {
+    registry = new CommandRegistry();
+    registry->references = 1;
+  }
+  else if (registry->references > 1) {
+    registry->references--;
+    registry = new CommandRegistry(*registry);
+    registry->references = 1;
+  }
+  return registry;
+}
+
+/**
+ * Drops this interpreter's reference, freeing a registry it allocated once 
+ * no copies use it. Registries owned by the caller are never freed.
+ */
+void CommandInterpreter::releaseRegistry() {
+  if (registry != NULL && registry->references > 0 && --registry->references == 0)
+    delete registry;
+  registry = NULL;
 }
 
 /**
  * Executes a registered function by its index in the cmdFunctions list.
  * 
  * @param index  The index of the registered command (returned from register).
+ * @return  False if no handler was found or the arguments were invalid.
  */
-void CommandInterpreter::execute(Stream& port, char* command, char* arguments) {
-  typedef void func(Stream&, int, const char**);
+bool CommandInterpreter::execute(Stream& port, char* command, char* arguments) {
+
+  //Find the function first, unknown commands need no argument parsing
+  if (registry == NULL)
+    return false;
+  bool timed = registry->statsEnabled();
+  uint32_t parseStart = timed ? ESP.getCycleCount() : 0;
+  uint32_t schema = 0;
+  int slot = CommandRegistry::STATS_DEFAULT;
+  Handler f = registry->findHandler(command, schema, slot);
+  if (f == NULL && strcmp(command, "cmd-stats") == 0) {
+    commandStats(port, arguments);
+    return true;
+  }
+  if (f == NULL)
+    f = registry->getDefault();
+  if (f == NULL)
+    return false;
 
   //Divide up arguments
   int argc = 0;
@@ -64,25 +144,63 @@ void CommandInterpreter::execute(Stream& port, char* command, char* arguments) {
     escaped = false;
   }
 
-  //Find the function and execute
-  for (int i = 0; i < cmdCount; i++) {
-
-    if (strcmp(command, &cmdNames[i * (CMD_LENGTH + 1)]) == 0) {
-
-      if (cmdFunctions[i] == NULL)
-        break;
-      
-      func* f = (func*)cmdFunctions[i];
-      f(port, argc, (const char**)&cmdArgPointers[0]);
-      return;
+  //Typed handlers get their arguments decoded and validated up front
+  if (schema != 0) {
+    Argument values[CommandRegistry::CMD_MAX_TYPED_ARGS];
+    if (!CommandRegistry::decodeArguments(schema, argc, (const char**)cmdArgPointers, values)) {
+      replyError(port, "ER: Invalid arguments\n");
+      return false;
     }
+    
+    TypedHandler typed = (TypedHandler)f;
+    uint32_t handlerStart = timed ? ESP.getCycleCount() : 0;
+    typed(port, argc, values);
+    if (timed)
+      registry->recordStats(slot, handlerStart - parseStart, ESP.getCycleCount() - handlerStart);
+    return true;
   }
 
-  if (cmdFunctionDefault == NULL)
+  uint32_t handlerStart = timed ? ESP.getCycleCount() : 0;
+  f(port, argc, (const char**)&cmdArgPointers[0]);
+  if (timed)
+    registry->recordStats(slot, handlerStart - parseStart, ESP.getCycleCount() - handlerStart);
+  return true;
+}
+
+/**
+ * Built-in command reporting per-command statistics, available on every
+ * interpreter unless a command of the same name is assigned.
+ * Usage: cmd-stats [on/off/reset]
+ */
+void CommandInterpreter::commandStats(Stream& port, const char* arguments) {
+  
+  if (strcmp(arguments, "on") == 0)
+    registry->enableStats(true);
+  else if (strcmp(arguments, "off") == 0)
+    registry->enableStats(false);
+  else if (strcmp(arguments, "reset") == 0)
+    registry->resetStats();
+  else if (arguments[0] != '\0') {
+    replyError(port, "ER: Usage cmd-stats [on/off/reset]\n");
     return;
+  }
+  
+  if (registry->statsEnabled())
+    registry->printStats(port);
+  else
+    port.print("Command stats are off, enable with: cmd-stats on\n");
+  port.flush();
+}
 
-  func* f = (func*)cmdFunctionDefault;
-  f(port, argc, (const char**)&cmdArgPointers[0]);
+/**
+ * Turns per-command statistics on or off for the commands of this
+ * interpreter. Statistics are kept by the registry, so sessions sharing one
+ * registry share statistics too. See the built-in cmd-stats command.
+ */
+void CommandInterpreter::enableStats(bool enable) {
+  if (registry == NULL)
+    writableRegistry();
+  registry->enableStats(enable);
 }
 
 /**
@@ -92,20 +210,19 @@ void CommandInterpreter::execute(Stream& port, char* command, char* arguments) {
  * @param commandToRegister  integer no-args function to call for this command.
  * @return  The command index for this command or -1 if failed.
  */
-int CommandInterpreter::assign(char* commandName, 
+int CommandInterpreter::assign(const char* commandName, 
     void (*commandToRegister)(Stream&, int, const char**)) {
-  if (cmdCount >= CMD_MAX_COUNT)
-    return -1;
-  
-  cmdFunctions[cmdCount] = (unsigned)commandToRegister;
-  int nameOffset = (CMD_LENGTH + 1) * cmdCount;
-  for (int i = 0; commandName[i] != '\0' && i < CMD_LENGTH; i++) {;
+  return writableRegistry()->assign(commandName, commandToRegister);
+}
 
-    cmdNames[i + nameOffset] = commandName[i];
-    cmdNames[i + nameOffset + 1] = '\0';
-  }
-  
-  return cmdCount++;
+/**
+ * Registers a typed function with a matching command (see CommandRegistry).
+ * 
+ * @return  The command index for this command or -1 if failed.
+ */
+int CommandInterpreter::assign(const char* commandName, 
+    void (*commandToRegister)(Stream&, int, const Argument*), const char* schema) {
+  return writableRegistry()->assign(commandName, commandToRegister, schema);
 }
 
 /**
@@ -114,48 +231,47 @@ int CommandInterpreter::assign(char* commandName,
  */
 int CommandInterpreter::assignDefault(
     void (*commandToRegister)(Stream&, int, const char**)) {
-  
-  cmdFunctionDefault = (unsigned)commandToRegister;
+  return writableRegistry()->assignDefault(commandToRegister);
+}
+
+/**
+ * Finds the index of a command registered with assign(name, function).
+ * 
+ * @return  The command index (as returned by assign) or -1 if not found.
+ */
+int CommandInterpreter::indexOf(const char* commandName) {
+  return registry != NULL ? registry->indexOf(commandName) : -1;
 }
 
 /**
  * Handles commands if they are present (between % and \n)
+ * Received lines are queued, then up to the budget are executed per call. 
+ * While the queue is full, reading stops and the stream holds further data.
  * 
  * @param port  The stream port to read for incomming commands (IP/UART/SoftSerial).
  */
 void CommandInterpreter::handle(Stream& port) {
-  char* entryPointer = NULL;
 
-  //Receiving commands, may never finish
-  while (port.available() > 0) {
-    if (cmdPointer >= CMD_BUFFER_SIZE) {
-      //Command too long, discard it. Safe option.
-      cmdPointer = 0;
-      return;  
-    }
-
-    //Retrieve value, handle exceptions
-    char received = port.read();
+  //Finish parsing data left over from the last call, then read in bulk
+  parseReceived();
+  while (cmdLineCount < CMD_QUEUE_LINES && cmdReceived < CMD_QUEUE_SIZE) {
+    int available = port.available();
+    if (available <= 0)
+      break;
     
-    if (received == '\r') 
-      continue;
-    
-    if (cmdPointer == 0 && prefix != '\0' && received != prefix)
-      continue;
-
-    //Store the char, null terminate and increment
-    cmdBuffer[cmdPointer] = received;
-    cmdBuffer[++cmdPointer] = '\0';
-
-    //Get a command ready to execute
-    if (cmdBuffer[cmdPointer - 1] == '\n') {
-      cmdBuffer[cmdPointer - 1] = '\0';
-      entryPointer = &cmdBuffer[prefix != '\0'];
-      cmdPointer = 0;
-    }
+    int room = CMD_QUEUE_SIZE - cmdReceived;
+    int count = port.readBytes(&cmdBuffer[cmdReceived], available < room ? available : room);
+    if (count <= 0)
+      break;
+    cmdReceived += count;
+    parseReceived();
   }
 
-  if (entryPointer != NULL) {
+  //Execute queued commands in order, up to the budget
+  int executed = 0;
+  for (; executed < cmdLineCount && executed < cmdBudget; executed++) {
+	char* entryPointer = &cmdBuffer[cmdLines[executed] + (prefix != '\0')];
+	
 	//Echo the command, if enabled
 	if (echoEnabled) {
 		if (sequenceNumbersEnabled)
@@ -168,13 +284,94 @@ void CommandInterpreter::handle(Stream& port) {
 	//Invoke the argument parser and function handler
 	CommandBufferStream wrapper(port, &sendCount, &receiveCount);
 	wrapper.enableSequenceNumbers(sequenceNumbersEnabled);
-    process(wrapper, entryPointer);
+    char* command = takeRequestId(wrapper, entryPointer);
+    if (command == NULL)
+      continue;
+    wrapper.setRequestId(requestId[0] != '\0' ? requestId : NULL);
+    process(wrapper, command);
+  }
+  
+  //Move the remaining lines, then any unparsed data, to the front
+  if (executed > 0) {
+    int start = executed < cmdLineCount ? cmdLines[executed] : cmdLineStart;
+    int parsed = cmdPointer - start;
+    int unparsed = cmdReceived - cmdScan;
+    memmove(cmdBuffer, &cmdBuffer[start], parsed);
+    memmove(&cmdBuffer[parsed], &cmdBuffer[cmdScan], unparsed);
+    for (int i = executed; i < cmdLineCount; i++)
+      cmdLines[i - executed] = cmdLines[i] - start;
+    cmdLineCount -= executed;
+    cmdLineStart -= start;
+    cmdPointer = parsed;
+    cmdScan = parsed;
+    cmdReceived = parsed + unparsed;
+  }
+}
+
+/**
+ * Parses received data into queued lines, resuming where the last call 
+ * stopped. Each run up to a line end is found with memchr and compacted in
+ * place: returns are dropped, data before a prefix is skipped and lines too
+ * long are discarded. Parsing pauses while the queue of lines is full.
+ */
+void CommandInterpreter::parseReceived() {
+  
+  while (cmdScan < cmdReceived && cmdLineCount < CMD_QUEUE_LINES) {
+    char* run = &cmdBuffer[cmdScan];
+    char* lineEnd = (char*)memchr(run, '\n', cmdReceived - cmdScan);
+    char* runEnd = lineEnd != NULL ? lineEnd : &cmdBuffer[cmdReceived];
+    cmdScan = lineEnd != NULL ? lineEnd - cmdBuffer + 1 : cmdReceived;
+    
+    //Skip the rest of a line that was too long
+    if (cmdDiscarding) {
+      cmdDiscarding = lineEnd == NULL;
+      continue;
+    }
+    
+    //A line only starts at the prefix character
+    if (cmdPointer == cmdLineStart && prefix != '\0') {
+      run = (char*)memchr(run, prefix, runEnd - run);
+      if (run == NULL)
+        continue;
+    }
+    
+    //Append the run to the line without returns
+    while (run < runEnd) {
+      char* returnChar = (char*)memchr(run, '\r', runEnd - run);
+      char* chunkEnd = returnChar != NULL ? returnChar : runEnd;
+      memmove(&cmdBuffer[cmdPointer], run, chunkEnd - run);
+      cmdPointer += chunkEnd - run;
+      run = chunkEnd + (returnChar != NULL);
+    }
+    
+    if (cmdPointer - cmdLineStart > CMD_BUFFER_SIZE) {
+      //Command too long, discard it. Safe option.
+      cmdPointer = cmdLineStart;
+      cmdDiscarding = lineEnd == NULL;
+      droppedCount++;
+      continue;
+    }
+
+    //Queue a complete command, null terminated
+    if (lineEnd != NULL) {
+      cmdBuffer[cmdPointer++] = '\0';
+      cmdLines[cmdLineCount++] = cmdLineStart;
+      cmdLineStart = cmdPointer;
+    }
+  }
+  
+  //Once everything is parsed, the space skipped over is free again
+  if (cmdScan == cmdReceived) {
+    cmdScan = cmdPointer;
+    cmdReceived = cmdPointer;
   }
 }
 
 /**
- * Handle UDP packets as commands.
- * Note: No command prefix supported at this time. 
+ * Handle UDP packets as commands. Every line of a datagram is executed in 
+ * order, and the replies are gathered into as few packets as possible. When
+ * a datagram holds more than one command, the replies to each command are
+ * followed by a result marker line, "[<index>] OK" or "[<index>] ER".
  */
 void CommandInterpreter::handleUdp(WiFiUDP& port) {
   
@@ -182,68 +379,260 @@ void CommandInterpreter::handleUdp(WiFiUDP& port) {
   if (!packetSize)
 	  return;
   
-  char* bufferPointer = &cmdBuffer[0];
-  int len = port.read(bufferPointer, CMD_BUFFER_SIZE);
+  int length = port.read(udpRequest, UDP_PACKET_SIZE);
+  if (length <= 0)
+    return;
+  udpRequest[length] = '\0';
   
-  //Check the command prefix
-  if (prefix != '\0') {
-	if (bufferPointer[0] == prefix)
-		bufferPointer++;
-	else
-		return;
+  //Echo the commands, if enabled
+  if (echoEnabled) {
+	port.beginPacket(port.remoteIP(), port.remotePort());
+    port.write((const uint8_t*)udpRequest, length);
+    if (udpRequest[length - 1] != '\n')
+      port.print("\n");
+	port.endPacket();
   }
   
-  //Null terminate and find new line for command end
-  cmdBuffer[len] = 0;
-  for (int i = 0; cmdBuffer[i] != 0; i++) {
-	if (cmdBuffer[i] == '\n') {
-	  cmdBuffer[i] = '\0';
-	  break;
-	}
+  //Terminate each line and count the commands (lines with the prefix)
+  int commandCount = 0;
+  for (int i = 0; i < length; i++) {
+    if (udpRequest[i] == '\n' || udpRequest[i] == '\r')
+      udpRequest[i] = '\0';
+    else if ((i == 0 || udpRequest[i - 1] == '\0') && (prefix == '\0' || udpRequest[i] == prefix))
+      commandCount++;
   }
   
-  //Echo the command, if enabled
-  if (echoEnabled) {
-	port.beginPacket(port.remoteIP(), port.remotePort());
-    port.print(bufferPointer);
-    port.print("\n");
-	port.endPacket();
+  //Parse args, call the handlers, responses spill into more packets if needed
+  ResponseStream response(udpResponse, UDP_PACKET_SIZE, &port);
+  int index = 0;
+  char* next = udpRequest;
+  while (next < &udpRequest[length]) {
+    
+    //Step over the line first, argument parsing splits it up in place
+    char* line = next;
+    next += strlen(line) + 1;
+    if (line[0] == '\0' || (prefix != '\0' && line[0] != prefix))
+      continue;
+    
+    receiveCount++;
+    char* command = takeRequestId(response, &line[prefix != '\0']);
+    response.setRequestId(requestId[0] != '\0' ? requestId : NULL);
+    bool success = command != NULL && process(response, command);
+    if (commandCount > 1)
+      response.printf("[%d] %s\n", index, success ? "OK" : "ER");
+    index++;
   }
+  sendCount += response.send();
+}
+
+/**
+ * Copies reply bytes into the buffer, starting each line with the request ID
+ * if one is set.
+ */
+size_t CommandInterpreter::ResponseStream::write(const uint8_t* data, size_t size) {
+  if (requestId == NULL)
+    return append(data, size);
   
-  //Parse args, call the handler
-  receiveCount++;
-  stringStream.clear();
-  process(stringStream, bufferPointer);
+  size_t written = 0;
+  while (written < size) {
+    if (!lineStarted) {
+      append((const uint8_t*)"#", 1);
+      append((const uint8_t*)requestId, strlen(requestId));
+      append((const uint8_t*)" ", 1);
+      lineStarted = true;
+    }
+    
+    const uint8_t* lineEnd = (const uint8_t*)memchr(&data[written], '\n', size - written);
+    size_t chunk = lineEnd != NULL ? lineEnd - &data[written] + 1 : size - written;
+    size_t appended = append(&data[written], chunk);
+    written += appended;
+    if (appended < chunk)
+      break;
+    if (lineEnd != NULL)
+      lineStarted = false;
+  }
   
-  //If the user made any stream response, send that response in a packet
-  String response = stringStream.getString();
-  if (response.length() > 0) {
-	port.beginPacket(port.remoteIP(), port.remotePort());
-	port.print(response);
-	port.endPacket();
-	sendCount++;
+  return written;
+}
+
+/**
+ * Copies bytes into the buffer. When full, the complete lines are sent to 
+ * the spill port (if any) and the partial line moves to the front.
+ */
+size_t CommandInterpreter::ResponseStream::append(const uint8_t* data, size_t size) {
+  
+  size_t written = 0;
+  while (written < size) {
+    if (length >= capacity) {
+      if (spillPort == NULL)
+        break;
+      
+      //Find the last line end, a single line filling the buffer goes whole
+      size_t sendLength = length;
+      while (sendLength > 0 && buffer[sendLength - 1] != '\n')
+        sendLength--;
+      if (sendLength == 0)
+        sendLength = length;
+      
+      spillPort->beginPacket(spillPort->remoteIP(), spillPort->remotePort());
+      spillPort->write((const uint8_t*)buffer, sendLength);
+      spillPort->endPacket();
+      packetCount++;
+      length -= sendLength;
+      memmove(buffer, &buffer[sendLength], length);
+    }
+    
+    size_t part = capacity - length;
+    part = size - written < part ? size - written : part;
+    memcpy(&buffer[length], &data[written], part);
+    length += part;
+    written += part;
+  }
+  
+  return written;
+}
+
+/**
+ * Sends what remains in the buffer to the spill port.
+ * 
+ * @return  The total number of packets this stream has sent.
+ */
+int CommandInterpreter::ResponseStream::send() {
+  
+  if (length > 0 && spillPort != NULL) {
+    spillPort->beginPacket(spillPort->remoteIP(), spillPort->remotePort());
+    spillPort->write((const uint8_t*)buffer, length);
+    spillPort->endPacket();
+    packetCount++;
+    length = 0;
+  }
+  
+  return packetCount;
+}
+
+/**
+ * Reads from the source stream, echoing each completed line back to it.
+ */
+int CommandInterpreter::CommandBufferStream::read() {
+  int realData = sourceStream->read();
+  if (realData <= 0) return realData;
+  
+  if (receiveLength >= LINE_SIZE)
+    passOn(receiveLine, receiveLength, receiveStarted, *receiveCount, "[<-- %04d] ", NULL, false);
+  receiveLine[receiveLength++] = (char)realData;
+  
+  //Send echo now?
+  if (realData == '\n')
+    passOn(receiveLine, receiveLength, receiveStarted, *receiveCount, "[<-- %04d] ", NULL, true);
+  
+  return realData;
+}
+
+/**
+ * Stages reply bytes, sending each line to the source stream once its new
+ * line character arrives.
+ */
+size_t CommandInterpreter::CommandBufferStream::write(const uint8_t* data, size_t size) {
+  
+  size_t remaining = size;
+  while (remaining > 0) {
+    const uint8_t* lineEnd = (const uint8_t*)memchr(data, '\n', remaining);
+    size_t chunk = lineEnd != NULL ? lineEnd - data + 1 : remaining;
+    remaining -= chunk;
+    
+    //Copy the chunk, passing on what we have if the line is too long
+    while (chunk > 0) {
+      if (sendLength >= LINE_SIZE)
+        passOn(sendLine, sendLength, sendStarted, *sendCount, "[--> %04d] ", requestId, false);
+      size_t part = LINE_SIZE - sendLength;
+      part = chunk < part ? chunk : part;
+      memcpy(&sendLine[sendLength], data, part);
+      sendLength += part;
+      data += part;
+      chunk -= part;
+    }
+    
+    //Send buffer now?
+    if (lineEnd != NULL)
+      passOn(sendLine, sendLength, sendStarted, *sendCount, "[--> %04d] ", requestId, true);
+  }
+  
+  return size;
+}
+
+/**
+ * Passes staged line data to the source stream. The sequence prefix and
+ * the tag (request ID) go before the first part of a line, and completing a
+ * line counts it.
+ */
+void CommandInterpreter::CommandBufferStream::passOn(char* line, int& length, 
+    bool& started, int& counter, const char* prefixFormat, const char* tag, bool complete) {
+  
+  if (length > 0 || complete) {
+    if (sequenceNumbersEnabled && !started)
+      sourceStream->printf(prefixFormat, counter);
+    if (tag != NULL && !started)
+      sourceStream->printf("#%s ", tag);
+    sourceStream->write((const uint8_t*)line, length);
+    started = true;
+    length = 0;
+  }
+  
+  if (complete) {
+    started = false;
+    counter++;
+  }
+}
+
+/**
+ * Takes an optional request ID ("#<id> ") off the front of a command and
+ * keeps it in requestId, so every line of the reply can be tagged with it.
+ * 
+ * @return  The command after the ID, or NULL if the ID is invalid.
+ */
+char* CommandInterpreter::takeRequestId(Stream& port, char* entryPointer) {
+  
+  requestId[0] = '\0';
+  if (entryPointer[0] != '#')
+    return entryPointer;
+  
+  char* id = &entryPointer[1];
+  int length = 0;
+  while (id[length] != ' ' && id[length] != '\0')
+    length++;
+  if (length == 0 || length > CMD_ID_LENGTH) {
+    replyError(port, "ER: Invalid request ID\n");
+    return NULL;
   }
+  
+  memcpy(requestId, id, length);
+  requestId[length] = '\0';
+  for (entryPointer = &id[length]; *entryPointer == ' '; entryPointer++);
+  return entryPointer;
 }
 
 /**
  * Take a command buffer pointer, chop into a command an an argument string.
  * The execute function will split the arguments apart. (FOR NOW)
  * TO-do: Move the argument splitting to this function.
+ * 
+ * @return  False if no handler was found or the arguments were invalid.
  */
-void CommandInterpreter::process(Stream& port, char* entryPointer) {
+bool CommandInterpreter::process(Stream& port, char* entryPointer) {
   
   //Generate the command pointer
   char* command = entryPointer;
   char* bufPtr = entryPointer;
   for (; *bufPtr != ' ' && *bufPtr != '\0'; bufPtr++);
-  *bufPtr = '\0';
   
-  //Find the args
-  for (bufPtr++; *bufPtr == ' ' && *bufPtr != '\0'; bufPtr++);
+  //Find the args, never stepping past the end of this command
+  if (*bufPtr != '\0')
+    *bufPtr++ = '\0';
+  for (; *bufPtr == ' '; bufPtr++);
   char* arguments = bufPtr;
 
   //Invoke the function
-  execute(port, command, arguments);
+  return execute(port, command, arguments);
 }
 
 /**
@@ -261,6 +650,14 @@ int CommandInterpreter::getReceiveCount() {
 	return this->receiveCount;
 }
 
+/**
+ * Gets the number of lines dropped by handle() for overflowing the receive 
+ * buffer (longer than CMD_BUFFER_SIZE).
+ */
+int CommandInterpreter::getDroppedCount() {
+	return this->droppedCount;
+}
+
 void CommandInterpreter::enableEcho(bool echoEnabled) {
 	this->echoEnabled = echoEnabled;
 }
@@ -268,3 +665,32 @@ void CommandInterpreter::enableEcho(bool echoEnabled) {
 void CommandInterpreter::enableSequenceNumbers(bool enabled) {
 	this->sequenceNumbersEnabled = enabled;
 }
+
+/**
+ * Sets whether this interpreter answers bad input (invalid arguments or
+ * request IDs) with an "ER:" line. On by default, turn it off for ports whose
+ * senders do not read replies.
+ */
+void CommandInterpreter::enableErrorReplies(bool enabled) {
+	this->errorRepliesEnabled = enabled;
+}
+
+/**
+ * Private
+ * Sends an error line, unless error replies are disabled.
+ */
+void CommandInterpreter::replyError(Stream& port, const char* message) {
+  if (!errorRepliesEnabled)
+    return;
+  port.print(message);
+  port.flush();
+}
+
+/**
+ * Sets how many queued commands handle() may execute per call. 
+ * 
+ * @param budget  Commands per call, at least 1.
+ */
+void CommandInterpreter::setBudget(int budget) {
+	this->cmdBudget = budget > 0 ? budget : 1;
+}
@@ -10,6 +10,7 @@
 #include <ESP8266HTTPClient.h>
 #include <WiFiUdp.h>
 #include <Stream.h>
+#include "CommandRegistry.h"
 
 class CommandInterpreter {
 
@@ -26,142 +27,196 @@ private:
     size_t write(uint8_t u_Data){ return 0x01; }
   };
   
-  //Special class to capture stream as String
-  class StringStream : public Stream {
+  //Special class to capture a response in a fixed buffer, never allocates
+  //    With a port to spill into, full buffers are sent as a packet on a line
+  //    boundary and capture continues. Without one, the response is truncated.
+  //    With a request ID set, every line starts with "#<id> ".
+  class ResponseStream : public Stream {
   public:
-    StringStream()   { return;    }
+    ResponseStream(char* buffer, size_t capacity, WiFiUDP* spillPort = NULL) {
+      this->buffer = buffer;
+      this->capacity = capacity;
+      this->spillPort = spillPort;
+    }
     int  available() { return 0;  }
     void flush()     { return;    }
     int  peek()      { return -1; }
     int  read()      { return -1; }
-    size_t write(uint8_t u_Data) {
-		
-		stringData = stringData + (char)u_Data;
-		return 0x01;
-	}
-	String getString() { return stringData; }
-	String clear() { stringData = String(""); }
+    size_t write(uint8_t u_Data) { return write(&u_Data, 1); }
+    size_t write(const uint8_t*, size_t);
+    int send();
+    const uint8_t* getData() { return (const uint8_t*)buffer; }
+    size_t getLength() { return length; }
+    void clear() { length = 0; }
+    void setRequestId(const char* id) { requestId = id; lineStarted = false; }
 
   private:
-	String stringData;
+    size_t append(const uint8_t*, size_t);
+    
+    char* buffer;
+    size_t capacity;
+    size_t length = 0;
+    WiFiUDP* spillPort;
+    int packetCount = 0;
+    const char* requestId = NULL;
+    bool lineStarted = false;
   };
   
   //Special class to buffer commands before sending them to another stream
   //    A new line character is used to send. Each send is counted. 
+  //    Lines are staged in fixed buffers; longer lines are passed on in parts.
+  //    With a request ID set, every sent line starts with "#<id> ".
   class CommandBufferStream : public Stream {
   public:
     CommandBufferStream(Stream& sourceStream, int* sendCounter = 0, int* receiveCounter = 0) {
-		this->sourceStream = &sourceStream;
-		stringReceiveData = String();
-		stringData = String();
-		sendCount = sendCounter != 0 ? sendCounter : &internalSendCounter;
-		receiveCount = receiveCounter != 0 ? receiveCounter : &internalReceiveCounter;
-	}
+      this->sourceStream = &sourceStream;
+      sendCount = sendCounter != 0 ? sendCounter : &internalSendCounter;
+      receiveCount = receiveCounter != 0 ? receiveCounter : &internalReceiveCounter;
+    }
     int  available() { return sourceStream->available(); }
     void flush() {
-		
-		sourceStream->print(stringData);
-		stringData = String();
-		sourceStream->flush();
-	}
+      
+      passOn(sendLine, sendLength, sendStarted, *sendCount, "[--> %04d] ", requestId, false);
+      sourceStream->flush();
+    }
     int peek()      { return sourceStream->peek(); }
-	
-    int read() {
-		int realData = sourceStream->read();
-		if (realData <= 0) return realData;
-		
-		uint8_t data = (uint8_t)(char)realData;
-		stringReceiveData += (char)data;
-		
-		//Send echo now?
-		if (data == (uint8_t)'\n') {
-			if (sequenceNumbersEnabled)
-				sourceStream->printf("[<-- %04d] %s", *receiveCount, stringReceiveData.c_str());
-			else
-				sourceStream->print(stringReceiveData);
-			stringReceiveData = "";
-			(*receiveCount)++;
-		}
-		
-		return realData;
-	}
-    size_t write(uint8_t u_Data) {
-		
-		stringData = stringData + (char)u_Data;
-		
-		//Send buffer now?
-		if (u_Data == (uint8_t)'\n') {
-			if (sequenceNumbersEnabled)
-				sourceStream->printf("[--> %04d] %s", *sendCount, stringData.c_str());
-			else
-				sourceStream->print(stringData);
-			stringData = "";
-			(*sendCount)++;
-		}
-		
-		return 0x01;
-	}
-	String getString() { return stringData; }
-	String getReceiveString() { return stringReceiveData; }
-	void enableSequenceNumbers(bool enable) { this->sequenceNumbersEnabled = enable; }
+    int read();
+    size_t write(uint8_t u_Data) { return write(&u_Data, 1); }
+    size_t write(const uint8_t*, size_t);
+    void enableSequenceNumbers(bool enable) { this->sequenceNumbersEnabled = enable; }
+    void setRequestId(const char* id) { requestId = id; }
 
   private:
-	String stringReceiveData;
-	String stringData;
-	Stream* sourceStream;
-	int internalReceiveCounter;
-	int internalSendCounter;
-	int* sendCount;
-	int* receiveCount;
-	bool sequenceNumbersEnabled = false;
+    static const int LINE_SIZE = 128;
+    
+    void passOn(char*, int&, bool&, int&, const char*, const char*, bool);
+    
+    char receiveLine[LINE_SIZE];
+    char sendLine[LINE_SIZE];
+    int receiveLength = 0;
+    int sendLength = 0;
+    bool receiveStarted = false;
+    bool sendStarted = false;
+    Stream* sourceStream;
+    int internalReceiveCounter = 0;
+    int internalSendCounter = 0;
+    int* sendCount;
+    int* receiveCount;
+    bool sequenceNumbersEnabled = false;
+    const char* requestId = NULL;
   };
   
-  //Number of commands possible to be registered (preallocated)
-  const static int CMD_MAX_COUNT = 32;
-  //Number of chars per command
-  const static int CMD_LENGTH = 16;
   //Size of receive buffer (max total command size plus args and LF)
   const static int CMD_BUFFER_SIZE = 255;
+  //Size of the queue holding received lines until they are executed
+  const static int CMD_QUEUE_SIZE = 384;
+  //Number of received lines the queue can hold
+  const static int CMD_QUEUE_LINES = 8;
+  //Number of queued lines executed per call to handle(), by default
+  const static int CMD_DEFAULT_BUDGET = 4;
   //Number of arguments possible
   const static int CMD_MAX_ARGS = 16;
+  //Number of chars in a request ID ("#<id> " before the command)
+  const static int CMD_ID_LENGTH = 8;
+  //Size of UDP request and response buffers (one MTU), shared by all interpreters
+  const static int UDP_PACKET_SIZE = 1460;
   //A pre-constructed null stream to send to UDP requests
   NullStream nullStream;
-  StringStream stringStream;
+  static char udpRequest[UDP_PACKET_SIZE + 1];
+  static char udpResponse[UDP_PACKET_SIZE];
 
-  //Command receive buffer
-  char cmdBuffer[CMD_BUFFER_SIZE + 1];
-  char cmdNames[CMD_MAX_COUNT * (CMD_LENGTH + 1)];
+  //Commands are looked up in a registry, which may be shared
+  CommandRegistry* registry = NULL;
+  
+  //Command receive queue, completed lines are null terminated
+  char cmdBuffer[CMD_QUEUE_SIZE];
+  uint16_t cmdLines[CMD_QUEUE_LINES];
   char* cmdArgPointers[CMD_MAX_ARGS];
-  //Store each command function (int, no-args!)
-  unsigned cmdFunctions[CMD_MAX_COUNT];
-  unsigned cmdFunctionDefault = 0;
-  //Store number of registered commands
-  int cmdCount = 0;
-  //If command is being read, this will be non-0
+  //Request ID of the command being executed, empty if it had none
+  char requestId[CMD_ID_LENGTH + 1];
+  //Number of completed lines waiting in the queue
+  int cmdLineCount = 0;
+  //Start and end of the line being read (received data is parsed in place)
+  int cmdLineStart = 0;
   int cmdPointer = 0;
+  //Next received byte to parse and the end of all received data
+  int cmdScan = 0;
+  int cmdReceived = 0;
+  //Set while skipping the rest of a line that was too long
+  bool cmdDiscarding = false;
+  //Number of queued lines to execute per call to handle()
+  int cmdBudget = CMD_DEFAULT_BUDGET;
   //Command prefix character
   char prefix = '\0';
   
   //Store command counters
   int receiveCount = 0;
   int sendCount = 0;
+  int droppedCount = 0;
   
-  void execute(Stream&, char*, char*);
-  void process(Stream&, char*);
+  bool execute(Stream&, char*, char*);
+  bool process(Stream&, char*);
+  void parseReceived();
+  char* takeRequestId(Stream&, char*);
+  void commandStats(Stream&, const char*);
+  void replyError(Stream&, const char*);
+  CommandRegistry* writableRegistry();
+  void releaseRegistry();
   bool echoEnabled = false;
   bool sequenceNumbersEnabled = false;
+  bool errorRepliesEnabled = true;
   
 public:
+  typedef CommandRegistry::Handler Handler;
+  typedef CommandRegistry::Command Command;
+  typedef CommandRegistry::Argument Argument;
+  typedef CommandRegistry::TypedHandler TypedHandler;
+
   CommandInterpreter();
-  CommandInterpreter(CommandInterpreter&);
-  int assign(char*, void (*)(Stream&, int, const char**));
+  CommandInterpreter(CommandRegistry&);
+  CommandInterpreter(const CommandInterpreter&);
+  CommandInterpreter& operator=(const CommandInterpreter&);
+  ~CommandInterpreter();
+  int assign(const char*, void (*)(Stream&, int, const char**));
+  int assign(const char*, void (*)(Stream&, int, const Argument*), const char*);
+  int indexOf(const char*);
   int assignDefault(void (*)(Stream&, int, const char**));
   void setPrefix(char);
   void handle(Stream&);
   void handleUdp(WiFiUDP&);
   void enableEcho(bool);
   void enableSequenceNumbers(bool);
+  void enableErrorReplies(bool);
+  void setBudget(int);
+  void enableStats(bool);
   
   int getSendCount();
   int getReceiveCount();
+  int getDroppedCount();
+  
+  static bool parseInteger(const char* text, long minimum, long maximum, long& out) {
+    return CommandRegistry::parseInteger(text, minimum, maximum, out);
+  }
+  static bool parseDecimal(const char* text, float& out) {
+    return CommandRegistry::parseDecimal(text, out);
+  }
+
+  /**
+   * Attaches a sorted, compile-time command table. Lookups binary search the
+   * table in place, so it is never copied to RAM.
+   * 
+   * @return  The number of table commands, or -1 if the table is not sorted.
+   */
+  template <int N>
+  int assign(const Command (&table)[N]) {
+    return writableRegistry()->assignTable(&table[0], N);
+  }
+
+  /**
+   * Compile-time check for command tables, use with static_assert.
+   */
+  template <int N>
+  static constexpr bool isSorted(const Command (&table)[N]) {
+    return CommandRegistry::isSorted(table);
+  }
 };
@@ -0,0 +1,379 @@
+/**
+ * The Flying Squirrels: Squirrel Lighting Controller
+ * Purpose: Command names and handlers, shared by any number of interpreters
+ * Date:    2026-10-17
+ */
+
+#include "CommandRegistry.h"
+
+/**
+ * Copies the registered commands. Statistics, if enabled, start over.
+ */
+CommandRegistry::CommandRegistry(const CommandRegistry& toCopy) {
+  memcpy(cmdNames, toCopy.cmdNames, sizeof(cmdNames));
+  memcpy(cmdFunctions, toCopy.cmdFunctions, sizeof(cmdFunctions));
+  memcpy(cmdOrder, toCopy.cmdOrder, sizeof(cmdOrder));
+  memcpy(cmdSchemas, toCopy.cmdSchemas, sizeof(cmdSchemas));
+  cmdFunctionDefault = toCopy.cmdFunctionDefault;
+  cmdCount = toCopy.cmdCount;
+  cmdTable = toCopy.cmdTable;
+  cmdTableCount = toCopy.cmdTableCount;
+  if (toCopy.stats != NULL)
+    enableStats(true);
+}
+
+CommandRegistry::~CommandRegistry() {
+  delete stats;
+}
+
+/**
+ * Decodes the split arguments according to a compiled schema.
+ * 
+ * @return  False if the argument count or any value does not fit the schema.
+ */
+bool CommandRegistry::decodeArguments(uint32_t schema, int argc, const char** argv, Argument* values) {
+  
+  for (int i = 0; i < CMD_MAX_TYPED_ARGS; i++) {
+    uint8_t type = (schema >> (i * 4)) & 0x7;
+    bool optional = (schema >> (i * 4)) & 0x8;
+    
+    if (type == SCHEMA_END)
+      return argc <= i;
+    if (i >= argc)
+      return optional;
+
+    const char* text = argv[i];
+    switch (type) {
+      case SCHEMA_U8:
+        if (!parseInteger(text, 0, 255, values[i].integer))
+          return false;
+        break;
+      case SCHEMA_U16:
+        if (!parseInteger(text, 0, 65535, values[i].integer))
+          return false;
+        break;
+      case SCHEMA_INT:
+        if (!parseInteger(text, -2147483647L, 2147483647L, values[i].integer))
+          return false;
+        break;
+      case SCHEMA_FLOAT:
+        if (!parseDecimal(text, values[i].decimal))
+          return false;
+        break;
+      case SCHEMA_STR:
+        values[i].text = text;
+        break;
+    }
+  }
+  
+  return argc <= CMD_MAX_TYPED_ARGS;
+}
+
+/**
+ * Parses a base 10 integer without libc, rejecting anything that is not
+ * entirely a number or falls outside the given bounds.
+ */
+bool CommandRegistry::parseInteger(const char* text, long minimum, long maximum, long& out) {
+  
+  bool negative = *text == '-';
+  if (*text == '-' || *text == '+')
+    text++;
+  if (*text == '\0')
+    return false;
+  
+  unsigned long value = 0;
+  for (; *text != '\0'; text++) {
+    if (*text < '0' || *text > '9')
+      return false;
+    value = value * 10 + (*text - '0');
+    if (value > 2147483648UL)
+      return false;
+  }
+  
+  long result = negative ? -(long)(value - 1) - 1 : (long)value;
+  if ((!negative && value > 2147483647UL) || result < minimum || result > maximum)
+    return false;
+  out = result;
+  return true;
+}
+
+/**
+ * Parses a decimal number as a fixed-point mantissa and scale, which is far
+ * cheaper than atof. Digits past the sixth decimal place are ignored.
+ */
+bool CommandRegistry::parseDecimal(const char* text, float& out) {
+  static const float SCALES[] = {1.0f, 10.0f, 100.0f, 1000.0f, 10000.0f, 100000.0f, 1000000.0f};
+  
+  bool negative = *text == '-';
+  if (*text == '-' || *text == '+')
+    text++;
+  
+  uint32_t whole = 0;
+  uint32_t fraction = 0;
+  uint8_t fractionDigits = 0;
+  bool digits = false;
+  for (; *text >= '0' && *text <= '9'; text++) {
+    whole = whole * 10 + (*text - '0');
+    digits = true;
+    if (whole > 100000000UL)
+      return false;
+  }
+  if (*text == '.') {
+    for (text++; *text >= '0' && *text <= '9'; text++) {
+      if (fractionDigits < 6) {
+        fraction = fraction * 10 + (*text - '0');
+        fractionDigits++;
+      }
+      digits = true;
+    }
+  }
+  if (!digits || *text != '\0')
+    return false;
+  
+  float value = (float)whole + (float)fraction / SCALES[fractionDigits];
+  out = negative ? -value : value;
+  return true;
+}
+
+/**
+ * Resolves a command name to its handler, searching the flash table first.
+ * 
+ * @param schema  Set to the compiled argument schema of a typed command.
+ * @param slot  Set to the statistics slot of the command.
+ * @return  The handler, or NULL if the command is not registered.
+ */
+CommandRegistry::Handler CommandRegistry::findHandler(const char* command, uint32_t& schema, int& slot) {
+
+  //Binary search the sorted flash table
+  int low = 0;
+  int high = cmdTableCount - 1;
+  while (low <= high) {
+    int middle = (low + high) / 2;
+    int compare = strcmp_P(command, cmdTable[middle].name);
+    if (compare == 0) {
+      slot = STATS_DEFAULT + 1 + middle;
+      return (Handler)pgm_read_ptr(&cmdTable[middle].handler);
+    }
+    if (compare < 0)
+      high = middle - 1;
+    else
+      low = middle + 1;
+  }
+
+  int index = findAssigned(command);
+  if (index < 0)
+    return NULL;
+  
+  schema = cmdSchemas[index];
+  slot = index;
+  return cmdFunctions[index];
+}
+
+/**
+ * Binary searches the commands registered with assign(name, function).
+ * When a name was registered twice, the first registration wins.
+ * 
+ * @return  The command index, or -1 if not registered.
+ */
+int CommandRegistry::findAssigned(const char* command) {
+  
+  int low = 0;
+  int high = cmdCount;
+  while (low < high) {
+    int middle = (low + high) / 2;
+    if (strcmp(&cmdNames[cmdOrder[middle] * (CMD_LENGTH + 1)], command) < 0)
+      low = middle + 1;
+    else
+      high = middle;
+  }
+
+  if (low < cmdCount && strcmp(&cmdNames[cmdOrder[low] * (CMD_LENGTH + 1)], command) == 0)
+    return cmdOrder[low];
+  return -1;
+}
+
+/**
+ * Finds the index of a command registered with assign(name, function).
+ * 
+ * @param commandName  The command text to look up.
+ * @return  The command index (as returned by assign) or -1 if not found.
+ */
+int CommandRegistry::indexOf(const char* commandName) {
+  return findAssigned(commandName);
+}
+
+/**
+ * Registers a new function with a matching command.
+ * 
+ * @param commandName  String command text max length of CMD_LENGTH.
+ * @param commandToRegister  integer no-args function to call for this command.
+ * @return  The command index for this command or -1 if failed.
+ */
+int CommandRegistry::assign(const char* commandName, 
+    void (*commandToRegister)(Stream&, int, const char**)) {
+  if (cmdCount >= CMD_MAX_COUNT)
+    return -1;
+  
+  cmdFunctions[cmdCount] = commandToRegister;
+  cmdSchemas[cmdCount] = 0;
+  int nameOffset = (CMD_LENGTH + 1) * cmdCount;
+  cmdNames[nameOffset] = '\0';
+  for (int i = 0; commandName[i] != '\0' && i < CMD_LENGTH; i++) {;
+
+    cmdNames[i + nameOffset] = commandName[i];
+    cmdNames[i + nameOffset + 1] = '\0';
+  }
+  
+  //Insert into the sorted index after any equal names (first one wins)
+  const char* name = &cmdNames[nameOffset];
+  int position = cmdCount;
+  for (; position > 0; position--) {
+    if (strcmp(&cmdNames[cmdOrder[position - 1] * (CMD_LENGTH + 1)], name) <= 0)
+      break;
+    cmdOrder[position] = cmdOrder[position - 1];
+  }
+  cmdOrder[position] = cmdCount;
+  
+  return cmdCount++;
+}
+
+/**
+ * Registers a typed function with a matching command. The schema lists the
+ * argument types, separated by spaces, optional arguments in brackets at the
+ * end. Types are u8, u16, int, float and str. Example: "u8 u8 u8 [u8] [u8]".
+ * The function is only called when the arguments match the schema.
+ * 
+ * @return  The command index for this command or -1 if failed.
+ */
+int CommandRegistry::assign(const char* commandName, 
+    void (*commandToRegister)(Stream&, int, const Argument*), const char* schema) {
+  
+  uint32_t compiled = compileSchema(schema);
+  if (compiled == 0)
+    return -1;
+  
+  int index = assign(commandName, (Handler)commandToRegister);
+  if (index >= 0)
+    cmdSchemas[index] = compiled;
+  return index;
+}
+
+/**
+ * Packs a schema string into 4 bits per argument: the low 3 bits hold the
+ * type and the high bit marks it optional. The top bit flags a typed command.
+ * 
+ * @return  The compiled schema, or 0 if the schema is invalid.
+ */
+uint32_t CommandRegistry::compileSchema(const char* schema) {
+  static const char* TYPE_NAMES[] = {"u8", "u16", "int", "float", "str"};
+  
+  uint32_t compiled = SCHEMA_TYPED;
+  int count = 0;
+  bool optionalSeen = false;
+  while (*schema != '\0') {
+    if (*schema == ' ') {
+      schema++;
+      continue;
+    }
+    if (count >= CMD_MAX_TYPED_ARGS)
+      return 0;
+    
+    //Find the extent of this type name
+    bool optional = *schema == '[';
+    if (optional)
+      schema++;
+    int length = 0;
+    while (schema[length] != '\0' && schema[length] != ' ' && schema[length] != ']')
+      length++;
+    
+    uint32_t type = SCHEMA_END;
+    for (int t = 0; t < 5; t++)
+      if (strlen(TYPE_NAMES[t]) == (size_t)length && strncmp(schema, TYPE_NAMES[t], length) == 0)
+        type = SCHEMA_U8 + t;
+    schema += length;
+    
+    //Required arguments cannot follow optional ones
+    if (optional && *schema++ != ']')
+      return 0;
+    if (type == SCHEMA_END || (optionalSeen && !optional))
+      return 0;
+    optionalSeen = optional;
+    
+    compiled |= (type | (optional ? 0x8 : 0)) << (count * 4);
+    count++;
+  }
+  
+  return compiled;
+}
+
+/**
+ * Attaches a command table, which must be sorted by name. The table is
+ * searched before commands registered with assign(name, function).
+ */
+int CommandRegistry::assignTable(const Command* table, int count) {
+  
+  char previous[CMD_LENGTH + 1];
+  char current[CMD_LENGTH + 1];
+  for (int i = 1; i < count; i++) {
+    memcpy_P(previous, table[i - 1].name, CMD_LENGTH + 1);
+    memcpy_P(current, table[i].name, CMD_LENGTH + 1);
+    if (strcmp(previous, current) >= 0)
+      return -1;
+  }
+  
+  cmdTable = table;
+  cmdTableCount = count;
+  
+  //The table's slots follow the others, and belonged to the old table
+  if (stats != NULL)
+    stats->resize(STATS_DEFAULT + 1 + cmdTableCount, STATS_DEFAULT + 1);
+  return count;
+}
+
+/**
+ * Assigns a default function to be called when a command is entered that
+ * does not resolve to any registered command.
+ */
+int CommandRegistry::assignDefault(
+    void (*commandToRegister)(Stream&, int, const char**)) {
+  
+  cmdFunctionDefault = commandToRegister;
+  return 0;
+}
+
+/**
+ * Turns per-command statistics on or off. Turning them on allocates a slot
+ * for every assignable command, the default handler and the current table.
+ * A table attached later gets slots of its own.
+ */
+void CommandRegistry::enableStats(bool enable) {
+  if (enable && stats == NULL)
+    stats = new CommandStats(STATS_DEFAULT + 1 + cmdTableCount);
+  else if (!enable) {
+    delete stats;
+    stats = NULL;
+  }
+}
+
+/**
+ * Prints a line of statistics for every command invoked so far.
+ */
+void CommandRegistry::printStats(Stream& port) {
+  if (stats == NULL)
+    return;
+  
+  char name[CMD_LENGTH + 1];
+  stats->printHeader(port);
+  for (int i = 0; i < cmdTableCount; i++) {
+    memcpy_P(name, cmdTable[i].name, CMD_LENGTH + 1);
+    stats->print(port, STATS_DEFAULT + 1 + i, name);
+  }
+  for (int i = 0; i < cmdCount; i++)
+    stats->print(port, cmdOrder[i], &cmdNames[cmdOrder[i] * (CMD_LENGTH + 1)]);
+  stats->print(port, STATS_DEFAULT, "(default)");
+}
+
+void CommandRegistry::resetStats() {
+  if (stats != NULL)
+    stats->reset();
+}
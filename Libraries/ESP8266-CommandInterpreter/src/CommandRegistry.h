@@ -0,0 +1,135 @@
+/**
+ * The Flying Squirrels: Squirrel Lighting Controller
+ * Purpose: Command names and handlers, shared by any number of interpreters
+ * Date:    2026-10-17
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <Stream.h>
+#include "CommandStats.h"
+
+class CommandRegistry {
+
+public:
+  //Number of commands possible to be registered (preallocated)
+  const static int CMD_MAX_COUNT = 32;
+  //Number of chars per command
+  const static int CMD_LENGTH = 16;
+  //Number of arguments a typed command schema may declare
+  const static int CMD_MAX_TYPED_ARGS = 7;
+
+  typedef void (*Handler)(Stream&, int, const char**);
+
+  //One entry of a command table built at compile time. Declare the table
+  //PROGMEM so the names and handlers stay in flash, keep it sorted by name.
+  struct Command {
+    char name[CMD_LENGTH + 1];
+    Handler handler;
+  };
+
+  //A pre-decoded argument, the member to read depends on the schema type:
+  //u8, u16 and int fill integer, float fills decimal and str fills text.
+  union Argument {
+    long integer;
+    float decimal;
+    const char* text;
+  };
+  typedef void (*TypedHandler)(Stream&, int, const Argument*);
+
+  //Statistics slot of the default handler, assigned commands use their index
+  //and table commands follow this one
+  const static int STATS_DEFAULT = CMD_MAX_COUNT;
+
+  CommandRegistry() {}
+  CommandRegistry(const CommandRegistry&);
+  CommandRegistry& operator=(const CommandRegistry&) = delete;
+  ~CommandRegistry();
+  int assign(const char*, void (*)(Stream&, int, const char**));
+  int assign(const char*, void (*)(Stream&, int, const Argument*), const char*);
+  int assignDefault(void (*)(Stream&, int, const char**));
+  int indexOf(const char*);
+  Handler findHandler(const char*, uint32_t&, int&);
+  Handler getDefault() { return cmdFunctionDefault; }
+
+  void enableStats(bool);
+  bool statsEnabled() { return stats != NULL; }
+  void recordStats(int slot, uint32_t parseCycles, uint32_t handlerCycles) {
+    //The handler being timed may have turned statistics off
+    if (stats != NULL)
+      stats->record(slot, parseCycles, handlerCycles);
+  }
+  void printStats(Stream&);
+  void resetStats();
+
+  static bool decodeArguments(uint32_t, int, const char**, Argument*);
+  static bool parseInteger(const char*, long, long, long&);
+  static bool parseDecimal(const char*, float&);
+
+  /**
+   * Attaches a sorted, compile-time command table. Lookups binary search the
+   * table in place, so it is never copied to RAM.
+   *
+   * @return  The number of table commands, or -1 if the table is not sorted.
+   */
+  template <int N>
+  int assign(const Command (&table)[N]) {
+    return assignTable(&table[0], N);
+  }
+  int assignTable(const Command*, int);
+
+  /**
+   * Compile-time check for command tables, use with static_assert.
+   */
+  template <int N>
+  static constexpr bool isSorted(const Command (&table)[N]) {
+    return isSortedFrom(&table[0], N, 1);
+  }
+
+private:
+  //Interpreters count their references to registries they allocate
+  friend class CommandInterpreter;
+  uint8_t references = 0;
+
+  char cmdNames[CMD_MAX_COUNT * (CMD_LENGTH + 1)];
+  //Store each command function
+  void (*cmdFunctions[CMD_MAX_COUNT])(Stream&, int, const char**);
+  void (*cmdFunctionDefault)(Stream&, int, const char**) = NULL;
+  //Command indexes sorted by name, maintained by assign() for binary search
+  uint8_t cmdOrder[CMD_MAX_COUNT];
+  //Compiled argument schema per command, 0 for plain argv handlers
+  uint32_t cmdSchemas[CMD_MAX_COUNT];
+  //Store number of registered commands
+  int cmdCount = 0;
+  //Optional sorted command table in flash (see assign(const Command (&)[N]))
+  const Command* cmdTable = NULL;
+  int cmdTableCount = 0;
+  //Optional statistics, allocated by enableStats(true)
+  CommandStats* stats = NULL;
+
+  int findAssigned(const char*);
+
+  //Argument types in a compiled schema
+  enum SchemaType {
+    SCHEMA_END = 0,
+    SCHEMA_U8 = 1,
+    SCHEMA_U16 = 2,
+    SCHEMA_INT = 3,
+    SCHEMA_FLOAT = 4,
+    SCHEMA_STR = 5
+  };
+  static const uint32_t SCHEMA_TYPED = 0x80000000UL;
+
+  static uint32_t compileSchema(const char*);
+
+  static constexpr int compareNames(const char* a, const char* b) {
+    //Compared as unsigned char, the same order as strcmp() at runtime
+    return (*a != *b || *a == '\0') ? (int)(unsigned char)*a - (int)(unsigned char)*b
+        : compareNames(a + 1, b + 1);
+  }
+  static constexpr bool isSortedFrom(const Command* table, int count, int index) {
+    return index >= count || (compareNames(table[index - 1].name, table[index].name) < 0
+        && isSortedFrom(table, count, index + 1));
+  }
+};
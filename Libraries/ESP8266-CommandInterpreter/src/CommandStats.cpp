@@ -0,0 +1,99 @@
+/**
+ * The Flying Squirrels: Squirrel Lighting Controller
+ * Purpose: Optional per-command invocation counts and execution times
+ * Date:    2026-10-17
+ */
+
+#include "CommandStats.h"
+
+/**
+ * @param slots  Number of commands to keep statistics for.
+ */
+CommandStats::CommandStats(int slots) {
+  this->slots = slots;
+  entries = new Entry[slots];
+  reset();
+}
+
+CommandStats::~CommandStats() {
+  delete[] entries;
+}
+
+/**
+ * Counts one invocation of a command.
+ *
+ * @param slot  The command's statistics slot (see CommandRegistry).
+ * @param parseCycles  CPU cycles spent on lookup and argument parsing.
+ * @param handlerCycles  CPU cycles spent in the handler.
+ */
+void CommandStats::record(int slot, uint32_t parseCycles, uint32_t handlerCycles) {
+  if (slot < 0 || slot >= slots)
+    return;
+
+  Entry& entry = entries[slot];
+  uint32_t elapsed = handlerCycles / ESP.getCpuFreqMHz();
+  entry.count++;
+  entry.totalMicros += elapsed;
+  entry.parseCycles += parseCycles;
+  if (elapsed < entry.minMicros)
+    entry.minMicros = elapsed;
+  if (elapsed > entry.maxMicros)
+    entry.maxMicros = elapsed;
+
+  //Buckets are < 16, 64, 256 uS, 1, 4, 16, 64 mS and the rest
+  int bucket = 0;
+  for (uint32_t scaled = elapsed >> 4; scaled > 0 && bucket < BUCKETS - 1; scaled >>= 2)
+    bucket++;
+  if (entry.histogram[bucket] < 0xFFFF)
+    entry.histogram[bucket]++;
+}
+
+void CommandStats::printHeader(Stream& port) {
+  port.print("command            count  min uS  avg uS  max uS  parse cyc  <16u <64u <256u <1m <4m <16m <64m more\n");
+}
+
+/**
+ * Prints one line of statistics, if the command has been invoked.
+ */
+void CommandStats::print(Stream& port, int slot, const char* name) {
+  if (slot < 0 || slot >= slots || entries[slot].count == 0)
+    return;
+
+  Entry& entry = entries[slot];
+  port.printf("%-16s %7lu %7lu %7lu %7lu %10lu ", name, (unsigned long)entry.count,
+      (unsigned long)entry.minMicros, (unsigned long)(entry.totalMicros / entry.count),
+      (unsigned long)entry.maxMicros, (unsigned long)(entry.parseCycles / entry.count));
+  for (int i = 0; i < BUCKETS; i++)
+    port.printf(" %4u", entry.histogram[i]);
+  port.print("\n");
+}
+
+void CommandStats::reset() {
+  for (int i = 0; i < slots; i++) {
+    memset(&entries[i], 0, sizeof(Entry));
+    entries[i].minMicros = 0xFFFFFFFF;
+  }
+}
+
+/**
+ * Changes the number of slots, keeping the statistics of the first ones.
+ *
+ * @param slots  Number of commands to keep statistics for.
+ * @param keep   Leading slots whose statistics are kept, the rest start over.
+ */
+void CommandStats::resize(int slots, int keep) {
+  if (keep > slots)
+    keep = slots;
+  if (keep > this->slots)
+    keep = this->slots;
+
+  Entry* resized = new Entry[slots];
+  memcpy(resized, entries, keep * sizeof(Entry));
+  for (int i = keep; i < slots; i++) {
+    memset(&resized[i], 0, sizeof(Entry));
+    resized[i].minMicros = 0xFFFFFFFF;
+  }
+  delete[] entries;
+  entries = resized;
+  this->slots = slots;
+}
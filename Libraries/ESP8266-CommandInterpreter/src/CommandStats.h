@@ -0,0 +1,39 @@
+/**
+ * The Flying Squirrels: Squirrel Lighting Controller
+ * Purpose: Optional per-command invocation counts and execution times
+ * Date:    2026-10-17
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <Stream.h>
+
+class CommandStats {
+
+public:
+  //Number of histogram buckets, 16 uS wide and then 4x wider each
+  const static int BUCKETS = 8;
+
+  CommandStats(int);
+  ~CommandStats();
+  void record(int, uint32_t, uint32_t);
+  void printHeader(Stream&);
+  void print(Stream&, int, const char*);
+  void reset();
+  void resize(int, int);
+  int getSlots() { return slots; }
+
+private:
+  struct Entry {
+    uint32_t count;
+    uint32_t minMicros;
+    uint32_t maxMicros;
+    uint64_t totalMicros;
+    uint64_t parseCycles;
+    uint16_t histogram[BUCKETS];
+  };
+
+  Entry* entries;
+  int slots;
+};
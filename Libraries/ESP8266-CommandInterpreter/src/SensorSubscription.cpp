@@ -0,0 +1,56 @@
+/**
+ * The Flying Squirrels: Squirrel Lighting Controller
+ * Purpose: Sensor node side of the subscribe command, pushing readings to a
+ *          subscriber instead of waiting to be polled
+ * Date:    2026-10-17
+ */
+
+#include "SensorSubscription.h"
+
+/**
+ * Handles "subscribe rate-ms [delta]", with the arguments of SCHEMA. Readings
+ * are sampled every rate-ms and pushed to the subscriber stream when they
+ * change by more than delta (default 0), or every HEARTBEAT mS. The current
+ * reading is sent right away, to the stream that asked. The subscription ends
+ * after LEASE mS unless renewed, or with a rate of 0.
+ */
+void SensorSubscription::subscribe(Stream& reply, int argc, const CommandInterpreter::Argument* argv) {
+  rate = argv[0].integer;
+  delta = argc > 1 ? argv[1].integer : 0;
+  subscribeTime = millis();
+  sampleTime = millis();
+  push(reply, reader());
+}
+
+/**
+ * Samples for the subscriber, and pushes the reading if it is due. Call this
+ * from the loop.
+ */
+void SensorSubscription::handle() {
+  if (rate == 0)
+    return;
+
+  uint32_t now = millis();
+  if (now - subscribeTime > LEASE) {
+    rate = 0;
+    return;
+  }
+  if (now - sampleTime < rate)
+    return;
+  sampleTime = now;
+
+  uint8_t level = reader();
+  if (abs(level - lastPushed) > delta || now - pushTime >= HEARTBEAT)
+    push(*subscriber, level);
+}
+
+/**
+ * Private
+ * Sends one reading line.
+ */
+void SensorSubscription::push(Stream& stream, uint8_t level) {
+  stream.printf("%i\n", level);
+  stream.flush();
+  lastPushed = level;
+  pushTime = millis();
+}
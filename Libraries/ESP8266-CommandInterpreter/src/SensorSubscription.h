@@ -0,0 +1,40 @@
+/**
+ * The Flying Squirrels: Squirrel Lighting Controller
+ * Purpose: Sensor node side of the subscribe command, pushing readings to a
+ *          subscriber instead of waiting to be polled
+ * Date:    2026-10-17
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include "CommandInterpreter.h"
+
+class SensorSubscription {
+
+public:
+  static const uint32_t HEARTBEAT = 500;  //mS between pushes of an unchanged reading
+  static const uint32_t LEASE = 10000;    //mS a subscription lasts unless renewed
+  static constexpr const char* SCHEMA = "u16 [u8]";  //subscribe rate-ms [delta]
+
+  typedef uint8_t (*Reader)();
+
+  SensorSubscription(Stream& subscriber, Reader reader)
+    : subscriber(&subscriber), reader(reader) {}
+
+  void subscribe(Stream&, int, const CommandInterpreter::Argument*);
+  void handle();
+  bool isActive() { return rate != 0; }
+
+private:
+  Stream* subscriber;
+  Reader reader;
+  uint16_t rate = 0;
+  uint8_t delta = 0;
+  uint32_t subscribeTime = 0;
+  uint32_t sampleTime = 0;
+  uint32_t pushTime = 0;
+  int lastPushed = -1;
+
+  void push(Stream&, uint8_t);
+};
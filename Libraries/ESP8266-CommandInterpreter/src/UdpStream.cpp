@@ -4,11 +4,56 @@
 UdpStream::UdpStream() {
 }
 
+UdpStream::~UdpStream() {
+	delete window;
+	delete[] receiveBacklog;
+	delete[] peers;
+}
+
+/**
+ * Switches to the reliable mode: flushed data is numbered, held in a small
+ * window until acknowledged, and retransmitted on an RTT-adaptive timeout.
+ * Both ends must enable it before begin(), replies travel reliably as well.
+ */
+void UdpStream::enableReliable(bool enabled) {
+	if (enabled && !window) {
+		window = new UdpWindow();
+		receiveBacklog = new char[UdpWindow::BACKLOG_SIZE];
+	}
+	else if (!enabled && window) {
+		delete window;
+		window = NULL;
+		delete[] receiveBacklog;
+		receiveBacklog = NULL;
+	}
+}
+
+/**
+ * Switches a server to session mode: each client, told apart by address and
+ * port, gets its own Peer stream with its own sequence numbers, queue and
+ * replies. The stream itself then reads nothing, read each peer(i) instead.
+ * Sessions use the plain protocol, a reliable stream still serves one client.
+ *
+ * @param count  Most clients served at once, 0 to turn sessions off.
+ */
+void UdpStream::enablePeers(int count) {
+	delete[] peers;
+	peers = NULL;
+	peerCount = 0;
+	pendingLength = 0;
+	if (count <= 0)
+		return;
+	
+	peers = new Peer[count];
+	peerCount = count;
+	for (int i = 0; i < count; i++)
+		peers[i].hub = this;
+}
+
 uint8_t UdpStream::begin(int port) {
 	isServer = true;
 	this->port = port;
 	
-	receiveData = String();
 	sendData = String();
 	
 	return _commonBegin();
@@ -19,7 +64,6 @@ uint8_t UdpStream::begin(IPAddress address, int port) {
 	this->port = port;
 	this->address = address;
 	
-	receiveData = String();
 	sendData = String();
 	
 	return _commonBegin();
@@ -33,7 +77,7 @@ int UdpStream::read() {
 	
 	//If we are receiving, fetch a byte
 	if (commandReceiving) {
-		int toReturn = receiveData[commandIndex++];
+		int toReturn = (uint8_t)receivePointer[commandIndex++];
 		
 		if (commandIndex >= commandLength)
 			commandReceiving = false;
@@ -45,34 +89,68 @@ int UdpStream::read() {
 	return -1;
 }
 
+/**
+ * Copies up to length bytes of the current command in one call, straight
+ * from the packet buffer. Unlike the Stream default, this never waits for
+ * more data than is available.
+ */
+size_t UdpStream::readBytes(char* buffer, size_t length) {
+	if (!_connected)
+		return 0;
+	
+	handleGetPacket();
+	if (!commandReceiving)
+		return 0;
+	
+	size_t count = commandLength - commandIndex;
+	if (count > length)
+		count = length;
+	memcpy(buffer, receivePointer + commandIndex, count);
+	commandIndex += count;
+	if (commandIndex >= commandLength)
+		commandReceiving = false;
+	
+	return count;
+}
+
 /**
  * Handles processing incoming packets if one is not already waiting to be processed.
  */
 void UdpStream::handleGetPacket() {
 	
+	//Reliable mode keeps acknowledging and retransmitting while received data
+	//is unread, polling once a millisecond between reads
+	if (window) {
+		if (_connected && (!commandReceiving || millis() != lastPollTime))
+			pollReliable();
+		if (state == CONNECTING)
+			handleConnect();
+		return;
+	}
+	
+	if (peers && isServer) {
+		if (_connected)
+			pollPeers();
+		return;
+	}
+	
+	//Held flushes go out once the coalescing window closes
+	if (heldLength > 0 && millis() - heldSince >= coalesceWindow)
+		sendHeld();
+	
 	//If not receiving a command, see if a packet has arrived
 	if (!commandReceiving) {
 		if ((commandLength = _connection.parsePacket()) > 0) {
 			
 			address = _connection.remoteIP();
-			int bytesRead = _connection.read(&receiveBuffer[0], commandLength);
-			commandLength = bytesRead;
-			receiveBuffer[commandLength] = '\0';
+			int bytesRead = _connection.read(&receiveBuffer[0], sizeof(receiveBuffer) - 1);
+			if (bytesRead <= 0)
+				return;
+			receiveBuffer[bytesRead] = '\0';
 			
 			//Get the sequence number and data start point
-			uint8_t returnCount = 0;
-			char* command = &receiveBuffer[0];
 			int recSequenceNumber = 0;
-			for (int i = 0; i < commandLength; i++) {
-				if (receiveBuffer[i] == '\r') returnCount++; else returnCount = 0;
-				
-				if (returnCount == 2) {
-					receiveBuffer[i - 1] = '\0';
-					command = &receiveBuffer[i + 1];
-					recSequenceNumber = atoi(&receiveBuffer[0]);
-					break;
-				}
-			}
+			char* command = parseHeader(bytesRead, recSequenceNumber);
 			
 			//Negative sequence number means sync packet
 			if (recSequenceNumber == -1) {
@@ -99,32 +177,571 @@ void UdpStream::handleGetPacket() {
 						return;
 				}
 				
-				//Our new command is ready
+				//Our new commands are read straight out of receiveBuffer, which
+				//is not refilled until all of them are consumed
 				receiveCounter++;
 				commandIndex = 0;
-				commandReceiving = true;
-				receiveData = String(command);
-				commandLength = receiveData.length();
+				receivePointer = command;
+				commandLength = bytesRead - (command - &receiveBuffer[0]);
+				commandReceiving = commandLength > 0;
 			}
 		}
 	}
+	
+	if (state == CONNECTING)
+		handleConnect();
+}
+
+/**
+ * Advances the client connect handshake without blocking. The sync packet is
+ * resent with exponential backoff until the server answers or the attempts
+ * run out.
+ */
+void UdpStream::handleConnect() {
+	if (synAck) {
+		state = CONNECTED;
+		
+		//Data flushed while connecting goes out now, as one flush
+		int length = connectBacklogLength;
+		connectBacklogLength = 0;
+		if (length > 0 && window) {
+			heldSince = millis();
+			flushedLength = length;
+			sendBacklog();
+		} else if (length > 0) {
+			sequenceNumber++;
+			sendPacket(length);
+		}
+		return;
+	}
+	
+	if (millis() - syncSentAt < syncDelay)
+		return;
+	
+	if (syncAttempts >= SYNC_ATTEMPTS) {
+		fail();
+		return;
+	}
+	syncDelay = syncDelay * 2 < SYNC_RETRY_MAX ? syncDelay * 2 : SYNC_RETRY_MAX;
+	sendSync();
+}
+
+void UdpStream::sendSync() {
+	_connection.beginPacket(address, port);
+	_connection.printf("-1\r\r\n");
+	_connection.endPacket();
+	syncSentAt = millis();
+	syncAttempts++;
+}
+
+/**
+ * Gives up on the peer. The client stays FAILED until begin() is called again.
+ */
+void UdpStream::fail() {
+	_connection.stop();
+	_connected = 0;
+	commandReceiving = false;
+	state = FAILED;
+	dropConnectBacklog();
+}
+
+/**
+ * Drops data flushed while connecting, which can no longer be sent.
+ */
+void UdpStream::dropConnectBacklog() {
+	if (connectBacklogLength == 0)
+		return;
+	sendData.remove(0, connectBacklogLength);
+	connectBacklogLength = 0;
+	sendDroppedCount++;
+}
+
+/**
+ * Splits the sequence number from the payload of the packet in receiveBuffer.
+ *
+ * @param sequence  Set to the sequence number, 0 if there is no header.
+ * @return  The start of the payload.
+ */
+char* UdpStream::parseHeader(int length, int& sequence) {
+	uint8_t returnCount = 0;
+	for (int i = 0; i < length; i++) {
+		if (receiveBuffer[i] == '\r') returnCount++; else returnCount = 0;
+		
+		if (returnCount == 2) {
+			receiveBuffer[i - 1] = '\0';
+			sequence = atoi(&receiveBuffer[0]);
+			return &receiveBuffer[i + 1];
+		}
+	}
+	sequence = 0;
+	return &receiveBuffer[0];
+}
+
+/**
+ * Reliable mode: takes in every waiting packet and retransmits what is due,
+ * also while received data is unread. Acknowledgements are -2 packets
+ * carrying "<cumulative> <selective> <trigger> <room>", where room is how many
+ * segments past cumulative this side can hold. A -3 packet asks for one.
+ */
+void UdpStream::pollReliable() {
+	lastPollTime = millis();
+	int packetLength;
+	while ((packetLength = _connection.parsePacket()) > 0) {
+		
+		address = _connection.remoteIP();
+		packetLength = _connection.read(&receiveBuffer[0], sizeof(receiveBuffer) - 1);
+		if (packetLength <= 0)
+			continue;
+		receiveBuffer[packetLength] = '\0';
+		
+		int recSequenceNumber = 0;
+		char* payload = parseHeader(packetLength, recSequenceNumber);
+		
+		if (recSequenceNumber == -1) {
+			//Sync, the server starts both directions over
+			if (isServer) {
+				window->reset();
+				commandReceiving = false;
+				sendData = String();
+				flushedLength = 0;
+				advertisedRoom = UdpWindow::WINDOW_SIZE;
+				probeDelay = 0;
+				_connection.beginPacket(address, port);
+				_connection.printf("-1\r\r\n");
+				_connection.endPacket();
+			}
+			else
+				synAck = true;
+		} else if (recSequenceNumber == -2) {
+			char* end;
+			long cumulative = strtol(payload, &end, 10);
+			uint32_t selective = strtoul(end, &end, 10);
+			long trigger = strtol(end, &end, 10);
+			//Peers that do not send their room are taken to have a full window
+			char* roomText = end;
+			long room = strtol(roomText, &end, 10);
+			if (end == roomText)
+				room = UdpWindow::WINDOW_SIZE;
+			window->acknowledge(cumulative, selective, trigger, room, millis());
+		} else if (recSequenceNumber == -3) {
+			sendAcknowledgement(0);
+		} else if (recSequenceNumber > 0) {
+			//Acknowledge duplicates too, the earlier acknowledgement may be lost.
+			//Deliver first, so the acknowledgement counts only the room taken
+			//by segments that do not fit in the backlog.
+			window->accept(recSequenceNumber, payload, packetLength - (payload - &receiveBuffer[0]));
+			deliverReliable();
+			sendAcknowledgement(recSequenceNumber);
+		}
+	}
+	
+	UdpWindow::Segment* segment;
+	while ((segment = window->nextDue(millis())) != NULL)
+		sendSegment(segment);
+	sendBacklog();
+	probeRoom();
+	checkBacklog();
+	if (!_connected)
+		return;
+	
+	deliverReliable();
+	
+	//A peer that was told there is no room waits for word that there is
+	if (advertisedRoom == 0 && window->getRoom() > 0)
+		sendAcknowledgement(0);
+}
+
+/**
+ * Reliable mode: moves segments that arrived in order out of the window, up to
+ * a backlog, so the peer can keep sending while this side is busy writing.
+ * Unread bytes are moved to the front only when a segment would not fit after
+ * them. Segments that do not fit stay in the window, and the peer is told it
+ * has less room rather than going unacknowledged.
+ */
+void UdpStream::deliverReliable() {
+	if (!commandReceiving) {
+		commandIndex = 0;
+		commandLength = 0;
+	}
+	UdpWindow::Segment* segment;
+	while ((segment = window->nextDeliverable()) != NULL
+			&& commandLength - commandIndex + segment->length <= UdpWindow::BACKLOG_SIZE) {
+		if (commandLength + segment->length > UdpWindow::BACKLOG_SIZE) {
+			memmove(receiveBacklog, receiveBacklog + commandIndex, commandLength - commandIndex);
+			commandLength -= commandIndex;
+			commandIndex = 0;
+		}
+		memcpy(receiveBacklog + commandLength, segment->data, segment->length);
+		commandLength += segment->length;
+		receivePointer = receiveBacklog;
+		commandReceiving = commandLength > 0;
+		receiveCounter++;
+		window->delivered(segment);
+	}
+}
+
+/**
+ * Session mode: moves waiting packets into their peers' queues. A packet whose
+ * peer has no room yet stays in receiveBuffer, and the socket is not read
+ * further until that peer is read.
+ */
+void UdpStream::pollPeers() {
+	while (true) {
+		if (pendingLength > 0) {
+			Peer& peer = *pendingPeer;
+			if (peer.queueLength + pendingLength > PEER_QUEUE_SIZE)
+				return;
+			if (peer.queueStart + peer.queueLength + pendingLength > PEER_QUEUE_SIZE) {
+				memmove(peer.queue, peer.queue + peer.queueStart, peer.queueLength);
+				peer.queueStart = 0;
+			}
+			memcpy(peer.queue + peer.queueStart + peer.queueLength, pendingData, pendingLength);
+			peer.queueLength += pendingLength;
+			peer.receiveCounter++;
+			receiveCounter++;
+			pendingLength = 0;
+		}
+		
+		if (_connection.parsePacket() <= 0)
+			return;
+		IPAddress remoteAddress = _connection.remoteIP();
+		uint16_t remotePort = _connection.remotePort();
+		int bytesRead = _connection.read(&receiveBuffer[0], sizeof(receiveBuffer) - 1);
+		if (bytesRead <= 0)
+			continue;
+		receiveBuffer[bytesRead] = '\0';
+		
+		int recSequenceNumber = 0;
+		char* payload = parseHeader(bytesRead, recSequenceNumber);
+		Peer* peer = findPeer(remoteAddress, remotePort);
+		if (!peer) {
+			refusedCount++;
+			continue;
+		}
+		peer->lastHeard = millis();
+		
+		//Sync starts only this peer's numbering over
+		if (recSequenceNumber == -1) {
+			peer->sequenceNumber = 0;
+			_connection.beginPacket(remoteAddress, remotePort);
+			_connection.printf("-1\r\r\n");
+			_connection.endPacket();
+		} else if (recSequenceNumber > peer->sequenceNumber) {
+			peer->sequenceNumber = recSequenceNumber;
+			pendingPeer = peer;
+			pendingData = payload;
+			pendingLength = bytesRead - (payload - &receiveBuffer[0]);
+			if (pendingLength > PEER_QUEUE_SIZE) {
+				droppedCount++;
+				pendingLength = 0;
+			}
+		}
+	}
+}
+
+/**
+ * @return  The session of the given client, a new one in a free slot, or the
+ *          one heard from longest ago if it has been silent for over
+ *          PEER_IDLE_TIMEOUT with nothing left to read or send. NULL if every
+ *          session is live, live sessions are never taken over.
+ */
+UdpStream::Peer* UdpStream::findPeer(IPAddress address, uint16_t port) {
+	Peer* slot = NULL;
+	for (int i = 0; i < peerCount; i++) {
+		Peer& peer = peers[i];
+		if (!peer.used) {
+			if (!slot)
+				slot = &peer;
+		} else if (peer.address == address && peer.port == port)
+			return &peer;
+	}
+	
+	if (!slot) {
+		uint32_t now = millis();
+		for (int i = 0; i < peerCount; i++) {
+			Peer& peer = peers[i];
+			if (now - peer.lastHeard > PEER_IDLE_TIMEOUT
+					&& peer.queueLength == 0 && peer.sendData.length() == 0
+					&& (!slot || now - peer.lastHeard > now - slot->lastHeard))
+				slot = &peer;
+		}
+	}
+	
+	if (slot)
+		slot->reset(address, port);
+	return slot;
+}
+
+void UdpStream::Peer::reset(IPAddress address, uint16_t port) {
+	used = true;
+	this->address = address;
+	this->port = port;
+	sequenceNumber = 0;
+	lastHeard = millis();
+	queueStart = 0;
+	queueLength = 0;
+	sendData = String();
+	receiveCounter = 0;
+	sendCounter = 0;
+}
+
+int UdpStream::Peer::available() {
+	hub->handleGetPacket();
+	return queueLength;
+}
+
+int UdpStream::Peer::read() {
+	hub->handleGetPacket();
+	if (queueLength == 0)
+		return -1;
+	
+	int toReturn = (uint8_t)queue[queueStart++];
+	if (--queueLength == 0)
+		queueStart = 0;
+	return toReturn;
+}
+
+int UdpStream::Peer::peek() {
+	hub->handleGetPacket();
+	return queueLength > 0 ? (uint8_t)queue[queueStart] : -1;
+}
+
+/**
+ * Copies up to length queued bytes, never waiting for more.
+ */
+size_t UdpStream::Peer::readBytes(char* buffer, size_t length) {
+	hub->handleGetPacket();
+	
+	size_t count = queueLength;
+	if (count > length)
+		count = length;
+	memcpy(buffer, queue + queueStart, count);
+	queueStart += count;
+	queueLength -= count;
+	if (queueLength == 0)
+		queueStart = 0;
+	return count;
+}
+
+size_t UdpStream::Peer::write(uint8_t u_Data) {
+	sendData += (char)u_Data;
+	return 1;
+}
+
+size_t UdpStream::Peer::write(const uint8_t* buffer, size_t size) {
+	sendData.concat((const char*)buffer, size);
+	return size;
+}
+
+/**
+ * Sends the reply to this peer, numbered with the last sequence number it sent.
+ */
+void UdpStream::Peer::flush() {
+	if (!used || !hub->_connected) {
+		sendData.remove(0);
+		return;
+	}
+	if (sendData.length() == 0)
+		return;
+	
+	hub->_connection.beginPacket(address, port);
+	hub->_connection.printf("%li\r\r", sequenceNumber);
+	hub->_connection.write((const uint8_t*)sendData.c_str(), sendData.length());
+	hub->_connection.endPacket();
+	sendCounter++;
+	hub->sendCounter++;
+	sendData.remove(0);
+}
+
+/**
+ * Reliable mode: numbers and sends flushed data while the window has room.
+ * While coalescing, a part shorter than a full segment waits for the deadline.
+ */
+void UdpStream::sendBacklog() {
+	int sentLength = 0;
+	while (flushedLength > 0 && window->canQueue()) {
+		if (flushedLength < UdpWindow::PAYLOAD_SIZE && coalesceWindow > 0
+				&& millis() - heldSince < coalesceWindow)
+			break;
+		int length = flushedLength < UdpWindow::PAYLOAD_SIZE ? flushedLength : UdpWindow::PAYLOAD_SIZE;
+		sendSegment(window->queue(sendData.c_str() + sentLength, length));
+		sentLength += length;
+		flushedLength -= length;
+	}
+	if (sentLength > 0)
+		sendData.remove(0, sentLength);
+}
+
+/**
+ * Reliable mode: a backlog that stays past BACKLOG_SIZE for the stream timeout
+ * is dropped, since the peer is not making room. A client then disconnects,
+ * so it syncs again on the next begin().
+ */
+void UdpStream::checkBacklog() {
+	if (flushedLength <= UdpWindow::BACKLOG_SIZE) {
+		backlogFull = false;
+		return;
+	}
+	if (!backlogFull) {
+		backlogFull = true;
+		backlogFullSince = millis();
+		return;
+	}
+	if (millis() - backlogFullSince < _timeout)
+		return;
+	
+	sendData = String();
+	flushedLength = 0;
+	backlogFull = false;
+	sendDroppedCount++;
+	if (!isServer)
+		fail();
+}
+
+void UdpStream::sendSegment(UdpWindow::Segment* segment) {
+	if (segment->transmissions == 0)
+		sendCounter++;
+	_connection.beginPacket(address, port);
+	_connection.printf("%li\r\r", segment->sequence);
+	_connection.write((const uint8_t*)segment->data, segment->length);
+	_connection.endPacket();
+	window->sent(segment, millis());
+}
+
+void UdpStream::sendAcknowledgement(long trigger) {
+	advertisedRoom = window->getRoom();
+	_connection.beginPacket(address, port);
+	_connection.printf("-2\r\r%li %lu %li %i\n", window->getCumulative(),
+			(unsigned long)window->getSelective(), trigger, advertisedRoom);
+	_connection.endPacket();
+}
+
+/**
+ * Reliable mode: while data waits only because the peer has no room, asks the
+ * peer for its room now and then, in case the word that it has room again
+ * was lost. The probes back off like retransmissions.
+ */
+void UdpStream::probeRoom() {
+	if (flushedLength == 0 || !window->idle() || !window->peerFull()) {
+		probeDelay = 0;
+		return;
+	}
+	if (probeDelay == 0) {
+		probeDelay = UdpWindow::RTO_MIN;
+		probeSentAt = millis();
+		return;
+	}
+	if (millis() - probeSentAt < probeDelay)
+		return;
+	
+	_connection.beginPacket(address, port);
+	_connection.printf("-3\r\r");
+	_connection.endPacket();
+	probeSentAt = millis();
+	probeDelay = probeDelay * 2 < UdpWindow::RTO_MAX ? probeDelay * 2 : UdpWindow::RTO_MAX;
 }
 
 size_t UdpStream::write(uint8_t u_Data) {
 	
-	//Write to the command buffer string
-	sendData = sendData + (char)u_Data;
+	//Write to the command buffer string, which keeps its buffer between sends
+	sendData += (char)u_Data;
 
 	return 1;
 }
+
+size_t UdpStream::write(const uint8_t* buffer, size_t size) {
+	sendData.concat((const char*)buffer, size);
+	return size;
+}
+
+/**
+ * Holds flushed data for up to the given time, so that flushes close together
+ * share one datagram. Held data also goes out once COALESCE_MTU bytes are
+ * waiting. The receiving end needs no change, it reads the same bytes.
+ *
+ * @param window  Milliseconds to hold a flush, 0 sends every flush at once.
+ */
+void UdpStream::setCoalesceWindow(uint32_t window) {
+	coalesceWindow = window;
+	if (window == 0 && heldLength > 0)
+		sendHeld();
+}
+
+/**
+ * Plain mode: sends the held bytes as one datagram.
+ */
+void UdpStream::sendHeld() {
+	if (heldLength == 0)
+		return;
+	sendPacket(heldLength);
+	heldLength = 0;
+}
+
+/**
+ * Plain mode: sends the first length bytes of sendData with the current
+ * sequence number.
+ */
+void UdpStream::sendPacket(int length) {
+	_connection.beginPacket(address, port);
+	_connection.printf("%li\r\r", sequenceNumber);
+	_connection.write((const uint8_t*)sendData.c_str(), length);
+	_connection.endPacket();
+	sendCounter++;
+	sendData.remove(0, length);
+}
 	
 /**
  * Triggers the sending of a UDP packet.
  */
 void UdpStream::flush() {
 	
-	if (!_connected)
+	//A client still connecting holds on to flushed data, up to a limit, and
+	//sends it once the server answers. Otherwise it is dropped and counted.
+	if (state != CONNECTED) {
+		if ((int)sendData.length() == connectBacklogLength)
+			return;
+		if (state == CONNECTING && sendData.length() <= CONNECT_BACKLOG_SIZE) {
+			connectBacklogLength = sendData.length();
+			return;
+		}
+		sendData.remove(connectBacklogLength);
+		heldLength = 0;
+		sendDroppedCount++;
+		return;
+	}
+	
+	//Reliable mode sends what fits in the window now, the rest goes out as
+	//acknowledgements make room, never waiting here. A flush that would take
+	//the backlog past twice BACKLOG_SIZE is dropped and counted.
+	if (window) {
+		if (sendData.length() > 2 * UdpWindow::BACKLOG_SIZE) {
+			sendData.remove(flushedLength);
+			sendDroppedCount++;
+			return;
+		}
+		if (flushedLength == 0)
+			heldSince = millis();
+		else if (coalesceWindow > 0)
+			coalescedCount++;
+		flushedLength = sendData.length();
+		sendBacklog();
+		checkBacklog();
+		return;
+	}
+	
+	//Session mode replies go out through each peer
+	if (peers && isServer) {
+		sendData.remove(0);
 		return;
+	}
+	
+	//Nothing new since the last flush, an empty datagram only costs airtime
+	if ((int)sendData.length() == heldLength)
+		return;
+	
+	//Held data that would overflow the datagram goes out on its own first
+	if (heldLength > 0 && sendData.length() > COALESCE_MTU)
+		sendHeld();
 	
 	if (isServer) {
 		//If server, use existing sequenceNumber
@@ -133,12 +750,20 @@ void UdpStream::flush() {
 		sequenceNumber++;
 	}
 	
-	_connection.beginPacket(address, port);
+	if (coalesceWindow > 0) {
+		if (heldLength == 0)
+			heldSince = millis();
+		else
+			coalescedCount++;
+		heldLength = sendData.length();
+		if (heldLength < COALESCE_MTU && millis() - heldSince < coalesceWindow)
+			return;
+		sendHeld();
+		return;
+	}
+	
 	//Send buffered command with sequence number
-	_connection.printf("%i\r\r%s", sequenceNumber, sendData.c_str());
-	_connection.endPacket();
-	sendCounter++;
-	sendData = String();
+	sendPacket(sendData.length());
 }
 
 uint8_t UdpStream::_commonBegin() {
@@ -147,21 +772,31 @@ uint8_t UdpStream::_commonBegin() {
 	_connected = _connection.begin(port);
 	if (_connected) {
 		commandReceiving = false;
-		receiveData = String();
-		sendData = String();
+		sendData.remove(0);
 		sequenceNumber = 0;
+		flushedLength = 0;
+		backlogFull = false;
+		heldLength = 0;
+		advertisedRoom = UdpWindow::WINDOW_SIZE;
+		probeDelay = 0;
+		if (window)
+			window->reset();
+		pendingLength = 0;
+		for (int i = 0; i < peerCount; i++)
+			peers[i].used = false;
 		
-		if (!isServer) {
-			//Sync the server
+		if (isServer)
+			state = CONNECTED;
+		else {
+			//Sync the server, the reply is picked up while polling
 			synAck = false;
-			_connection.beginPacket(address, port);
-			_connection.printf("-1\r\r\n");
-			_connection.endPacket();
-			String response = readStringUntil('\n');
-			if (!synAck)
-				_connected = 0;
+			state = CONNECTING;
+			syncAttempts = 0;
+			syncDelay = SYNC_RETRY_INITIAL;
+			sendSync();
 		}
-	}
+	} else
+		state = FAILED;
 	
 	return _connected;
 }
@@ -169,8 +804,20 @@ uint8_t UdpStream::_commonBegin() {
 void UdpStream::stop() {
 	_connection.stop();
 	_connected = false;
+	state = STOPPED;
+	dropConnectBacklog();
 }
 
+/**
+ * @return  True once the server answered the sync. Polling this advances a
+ *          pending connect, like read() and available() do.
+ */
 uint8_t UdpStream::connected() {
-	return _connected;
+	return getState() == CONNECTED;
+}
+
+UdpStream::ConnectState UdpStream::getState() {
+	if (state == CONNECTING)
+		handleGetPacket();
+	return state;
 }
\ No newline at end of file
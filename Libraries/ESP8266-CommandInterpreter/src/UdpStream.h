@@ -7,37 +7,137 @@
  
 #include <WiFiUDP.h>
 #include <Arduino.h>
+#include "UdpWindow.h"
  
 class UdpStream : public Stream {
 public:
+	//Client connect handshake, servers are CONNECTED once bound
+	enum ConnectState {
+		STOPPED,
+		CONNECTING,
+		CONNECTED,
+		FAILED
+	};
+	//Sync retries double from the first delay up to the maximum
+	const static uint32_t SYNC_RETRY_INITIAL = 250;
+	const static uint32_t SYNC_RETRY_MAX = 4000;
+	const static int SYNC_ATTEMPTS = 6;
+	//Received bytes each peer session holds until read
+	const static int PEER_QUEUE_SIZE = 512;
+	//mS a peer session must be silent before a new client may take it over
+	const static uint32_t PEER_IDLE_TIMEOUT = 10000;
+	//Most held bytes sent as one datagram while coalescing
+	const static int COALESCE_MTU = 1400;
+	//Most flushed bytes a client holds while it waits for the server to answer
+	const static int CONNECT_BACKLOG_SIZE = 512;
+	
+	/**
+	 * One client of a server in session mode, read and answered as its own
+	 * stream. Replies go back to the address and port the client sent from.
+	 */
+	class Peer : public Stream {
+	public:
+		virtual void flush();
+		virtual int read();
+		virtual int peek();
+		virtual int available();
+		virtual size_t write(uint8_t u_Data);
+		virtual size_t write(const uint8_t*, size_t);
+		virtual size_t readBytes(char*, size_t);
+		size_t readBytes(uint8_t* buffer, size_t length) { return readBytes((char*)buffer, length); }
+		
+		bool active() { return used; }
+		IPAddress remoteIP() { return address; }
+		uint16_t remotePort() { return port; }
+		int getSendCount() { return this->sendCounter; }
+		int getReceiveCount() { return this->receiveCounter; }
+		
+	private:
+		friend class UdpStream;
+		void reset(IPAddress, uint16_t);
+		
+		UdpStream* hub = NULL;
+		bool used = false;
+		IPAddress address;
+		uint16_t port = 0;
+		long sequenceNumber = 0;
+		uint32_t lastHeard = 0;
+		char queue[PEER_QUEUE_SIZE];
+		int queueStart = 0;
+		int queueLength = 0;
+		String sendData;
+		int receiveCounter = 0;
+		int sendCounter = 0;
+	};
+	
 	UdpStream();
+	~UdpStream();
 	
 	virtual void flush();
 	virtual int read();
-	virtual int peek()      { handleGetPacket(); return commandReceiving ? (int)receiveData[commandIndex] : -1; }
+	virtual int peek()      { handleGetPacket(); return commandReceiving ? (uint8_t)receivePointer[commandIndex] : -1; }
 	virtual int available() { handleGetPacket(); return commandReceiving ? commandLength - commandIndex : 0; }
 	virtual size_t write(uint8_t u_Data);
+	virtual size_t write(const uint8_t*, size_t);
+	virtual size_t readBytes(char*, size_t);
+	size_t readBytes(uint8_t* buffer, size_t length) { return readBytes((char*)buffer, length); }
+	int read(uint8_t* buffer, size_t length) { return readBytes((char*)buffer, length); }
 	
 	virtual uint8_t begin(int);
 	virtual uint8_t begin(IPAddress, int);
 	virtual void stop();
 	
 	virtual uint8_t connected();
+	ConnectState getState();
 	
 	int getSendCount() { return this->sendCounter; }
 	int getReceiveCount() { return this->receiveCounter; }
 	
+	void enableReliable(bool);
+	bool reliableEnabled() { return window != NULL; }
+	int getRetransmitCount() { return window ? window->getRetransmitCount() : 0; }
+	int getDuplicateCount() { return window ? window->getDuplicateCount() : 0; }
+	
+	void enablePeers(int);
+	int getPeerCount() { return peerCount; }
+	Peer& peer(int index) { return peers[index]; }
+	int getDroppedCount() { return droppedCount; }
+	int getRefusedCount() { return refusedCount; }
+	int getSendDroppedCount() { return sendDroppedCount; }
+	
+	void setCoalesceWindow(uint32_t);
+	int getCoalescedCount() { return coalescedCount; }
+	
 private:
 	virtual uint8_t _commonBegin();
 	void handleGetPacket();
+	void handleConnect();
+	void sendSync();
+	void fail();
+	void dropConnectBacklog();
+	char* parseHeader(int, int&);
+	void pollReliable();
+	void deliverReliable();
+	void sendSegment(UdpWindow::Segment*);
+	void sendBacklog();
+	void checkBacklog();
+	void sendAcknowledgement(long);
+	void probeRoom();
+	void sendHeld();
+	void sendPacket(int);
+	void pollPeers();
+	Peer* findPeer(IPAddress, uint16_t);
 	
 	char receiveBuffer[1500];
 	bool commandReceiving = false;
 	int commandIndex = 0;
 	int commandLength = 0;
+	//Start of the received data, in receiveBuffer or the reliable backlog
+	const char* receivePointer = NULL;
 	int port;
 	IPAddress address;
-	String receiveData;
+	//Reliable mode backlog of data taken out of the window, BACKLOG_SIZE bytes
+	char* receiveBacklog = NULL;
 	String sendData;
 	WiFiUDP _connection;
 	uint8_t _connected = 0;
@@ -46,6 +146,43 @@ private:
 	long sequenceNumber = 0;
 	bool isServer = false;
 	bool synAck = false;
+	ConnectState state = STOPPED;
+	uint32_t syncSentAt = 0;
+	uint32_t syncDelay = SYNC_RETRY_INITIAL;
+	int syncAttempts = 0;
+	//Optional reliable mode state, allocated by enableReliable(true)
+	UdpWindow* window = NULL;
+	//Leading bytes of sendData flushed but not yet in the window, and since
+	//when they have been over BACKLOG_SIZE
+	int flushedLength = 0;
+	bool backlogFull = false;
+	uint32_t backlogFullSince = 0;
+	//Room last advertised to the peer, and the probe for room while the
+	//peer has none (probeDelay is 0 while not probing)
+	int advertisedRoom = UdpWindow::WINDOW_SIZE;
+	uint32_t lastPollTime = 0;
+	uint32_t probeSentAt = 0;
+	uint32_t probeDelay = 0;
+	//Optional server session table, allocated by enablePeers()
+	Peer* peers = NULL;
+	int peerCount = 0;
+	//Packet in receiveBuffer waiting for room in its peer's queue
+	Peer* pendingPeer = NULL;
+	const char* pendingData = NULL;
+	int pendingLength = 0;
+	int droppedCount = 0;
+	//Packets from new clients turned away while every session was live
+	int refusedCount = 0;
+	//Leading bytes of sendData flushed while connecting, sent once connected,
+	//and flushes whose data was dropped unsent
+	int connectBacklogLength = 0;
+	int sendDroppedCount = 0;
+	//Coalescing: leading bytes of sendData flushed but held back, since when,
+	//and flushes that rode along in an earlier datagram
+	uint32_t coalesceWindow = 0;
+	uint32_t heldSince = 0;
+	int heldLength = 0;
+	int coalescedCount = 0;
 };
 
 #endif
@@ -0,0 +1,225 @@
+/**
+ * The Flying Squirrels: Squirrel Lighting Controller
+ * Purpose: Sliding window bookkeeping for the UdpStream reliable mode
+ * Date:    2026-10-17
+ */
+
+#include "UdpWindow.h"
+
+/**
+ * Forgets all segments in both directions, as after a sync.
+ */
+void UdpWindow::reset() {
+  for (int i = 0; i < WINDOW_SIZE; i++) {
+    sendSlots[i].used = false;
+    receiveSlots[i].used = false;
+  }
+  sendBase = 1;
+  sendNext = 1;
+  sendLimit = WINDOW_SIZE;
+  deliveredThrough = 0;
+  receivedThrough = 0;
+  smoothedRtt = 0;
+  rttVariance = 0;
+  rto = RTO_INITIAL;
+}
+
+/**
+ * @return  True if a segment may be sent, there is room in the window and the
+ *          peer has room to hold it.
+ */
+bool UdpWindow::canQueue() {
+  return sendNext - sendBase < WINDOW_SIZE && sendNext <= sendLimit;
+}
+
+/**
+ * Takes the next sequence number for a payload. Check canQueue() first.
+ *
+ * @param data  The payload, at most PAYLOAD_SIZE bytes are kept.
+ * @return  The segment to transmit.
+ */
+UdpWindow::Segment* UdpWindow::queue(const char* data, int length) {
+  Segment& segment = sendSlots[sendNext % WINDOW_SIZE];
+  if (length > PAYLOAD_SIZE)
+    length = PAYLOAD_SIZE;
+  memcpy(segment.data, data, length);
+  segment.data[length] = '\0';
+  segment.length = length;
+  segment.sequence = sendNext++;
+  segment.transmissions = 0;
+  segment.lossReported = false;
+  segment.used = true;
+  return &segment;
+}
+
+/**
+ * @return  The oldest segment never sent or past its retransmission timeout,
+ *          NULL if none is due.
+ */
+UdpWindow::Segment* UdpWindow::nextDue(uint32_t now) {
+  for (long sequence = sendBase; sequence < sendNext; sequence++) {
+    Segment& segment = sendSlots[sequence % WINDOW_SIZE];
+    if (segment.used && (segment.transmissions == 0 || now - segment.sentAt >= rto))
+      return &segment;
+  }
+  return NULL;
+}
+
+/**
+ * Notes a transmission. Timeouts of the oldest segment back off the timer,
+ * losses reported by the receiver do not.
+ */
+void UdpWindow::sent(Segment* segment, uint32_t now) {
+  if (segment->transmissions > 0) {
+    retransmitCount++;
+    if (segment->sequence == sendBase && !segment->lossReported)
+      rto = rto * 2 < RTO_MAX ? rto * 2 : RTO_MAX;
+  }
+  segment->lossReported = false;
+  if (segment->transmissions < 255)
+    segment->transmissions++;
+  segment->sentAt = now;
+}
+
+/**
+ * Releases acknowledged segments. Segments reported missing below a
+ * selectively acknowledged one are made due once, without waiting for the
+ * timeout.
+ *
+ * @param cumulative  Everything through this sequence number was received.
+ * @param selective  Bit i set means cumulative + 1 + i was received.
+ * @param trigger  The segment whose arrival caused this acknowledgement.
+ * @param room  Segments past cumulative the peer has room for (getRoom()).
+ */
+void UdpWindow::acknowledge(long cumulative, uint32_t selective, long trigger, int room, uint32_t now) {
+  if (cumulative >= sendNext)
+    return;
+
+  //The peer's room only ever grows at the far end, so a late acknowledgement
+  //with an older limit changes nothing
+  if (cumulative + room > sendLimit)
+    sendLimit = cumulative + room;
+
+  //Time only the segment that caused the acknowledgement, and only if it was
+  //sent once (Karn). A cumulative jump after a retransmission is no sample.
+  if (trigger >= sendBase && trigger < sendNext) {
+    Segment& segment = sendSlots[trigger % WINDOW_SIZE];
+    if (segment.used && segment.sequence == trigger && segment.transmissions == 1)
+      sampleRtt(now - segment.sentAt);
+  }
+
+  while (sendBase <= cumulative) {
+    Segment& segment = sendSlots[sendBase % WINDOW_SIZE];
+    if (segment.used && segment.sequence == sendBase)
+      segment.used = false;
+    sendBase++;
+  }
+
+  //Find the highest selectively acknowledged segment, holes below it are lost
+  int highest = -1;
+  for (int i = 0; i < WINDOW_SIZE; i++)
+    if (selective & (1UL << i))
+      highest = i;
+
+  for (int i = 0; i <= highest; i++) {
+    long sequence = cumulative + 1 + i;
+    Segment& segment = sendSlots[sequence % WINDOW_SIZE];
+    if (sequence < sendBase || sequence >= sendNext || !segment.used || segment.sequence != sequence)
+      continue;
+    if (selective & (1UL << i)) {
+      segment.used = false;
+    } else if (segment.transmissions == 1 && !segment.lossReported) {
+      segment.lossReported = true;
+      segment.sentAt = now - rto;
+    }
+  }
+}
+
+/**
+ * Jacobson/Karels estimator, integer arithmetic as in BSD TCP.
+ */
+void UdpWindow::sampleRtt(uint32_t measured) {
+  if (smoothedRtt == 0) {
+    smoothedRtt = measured << 3;
+    rttVariance = measured << 1;
+  } else {
+    long delta = (long)measured - (long)(smoothedRtt >> 3);
+    smoothedRtt += delta;
+    if (delta < 0)
+      delta = -delta;
+    delta -= rttVariance >> 2;
+    rttVariance += delta;
+  }
+
+  rto = (smoothedRtt >> 3) + rttVariance;
+  if (rto < RTO_MIN)
+    rto = RTO_MIN;
+  if (rto > RTO_MAX)
+    rto = RTO_MAX;
+}
+
+/**
+ * Holds a received segment for in-order delivery.
+ *
+ * @return  DUPLICATE if already received, OUT_OF_WINDOW if there is no room.
+ *          Either way the sender should be acknowledged again.
+ */
+UdpWindow::Acceptance UdpWindow::accept(long sequence, const char* data, int length) {
+  if (sequence <= deliveredThrough) {
+    duplicateCount++;
+    return DUPLICATE;
+  }
+  if (sequence > deliveredThrough + WINDOW_SIZE)
+    return OUT_OF_WINDOW;
+
+  Segment& segment = receiveSlots[sequence % WINDOW_SIZE];
+  if (segment.used && segment.sequence == sequence) {
+    duplicateCount++;
+    return DUPLICATE;
+  }
+
+  if (length > PAYLOAD_SIZE)
+    length = PAYLOAD_SIZE;
+  memcpy(segment.data, data, length);
+  segment.data[length] = '\0';
+  segment.length = length;
+  segment.sequence = sequence;
+  segment.used = true;
+
+  while (true) {
+    Segment& next = receiveSlots[(receivedThrough + 1) % WINDOW_SIZE];
+    if (!next.used || next.sequence != receivedThrough + 1)
+      break;
+    receivedThrough++;
+  }
+  return ACCEPTED;
+}
+
+/**
+ * @return  The next segment in sequence, NULL if it has not arrived.
+ */
+UdpWindow::Segment* UdpWindow::nextDeliverable() {
+  Segment& segment = receiveSlots[(deliveredThrough + 1) % WINDOW_SIZE];
+  if (segment.used && segment.sequence == deliveredThrough + 1)
+    return &segment;
+  return NULL;
+}
+
+void UdpWindow::delivered(Segment* segment) {
+  segment->used = false;
+  deliveredThrough = segment->sequence;
+}
+
+/**
+ * @return  The selective acknowledgement bits to send with getCumulative().
+ */
+uint32_t UdpWindow::getSelective() {
+  uint32_t selective = 0;
+  for (int i = 1; i < WINDOW_SIZE; i++) {
+    long sequence = receivedThrough + 1 + i;
+    Segment& segment = receiveSlots[sequence % WINDOW_SIZE];
+    if (segment.used && segment.sequence == sequence)
+      selective |= 1UL << i;
+  }
+  return selective;
+}
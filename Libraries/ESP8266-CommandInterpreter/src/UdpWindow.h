@@ -0,0 +1,89 @@
+/**
+ * The Flying Squirrels: Squirrel Lighting Controller
+ * Purpose: Sliding window bookkeeping for the UdpStream reliable mode
+ * Date:    2026-10-17
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+class UdpWindow {
+
+public:
+  //Datagrams in flight (and held for reordering) in each direction, max 32
+  const static int WINDOW_SIZE = 4;
+  //Largest payload per datagram, longer flushes are split
+  const static int PAYLOAD_SIZE = 256;
+  //Flushed bytes a stream may hold back while the window is full
+  const static int BACKLOG_SIZE = 1024;
+  //Retransmission timeout bounds and the value used before any RTT sample
+  const static uint32_t RTO_MIN = 20;
+  const static uint32_t RTO_MAX = 2000;
+  const static uint32_t RTO_INITIAL = 250;
+
+  struct Segment {
+    long sequence;
+    uint16_t length;
+    bool used;
+    //Send side only
+    uint8_t transmissions;
+    bool lossReported;
+    uint32_t sentAt;
+    char data[PAYLOAD_SIZE + 1];
+  };
+
+  //Outcomes of accept()
+  enum Acceptance {
+    ACCEPTED,
+    DUPLICATE,
+    OUT_OF_WINDOW
+  };
+
+  UdpWindow() { reset(); }
+  void reset();
+
+  bool canQueue();
+  Segment* queue(const char*, int);
+  Segment* nextDue(uint32_t);
+  void sent(Segment*, uint32_t);
+  void acknowledge(long, uint32_t, long, int, uint32_t);
+  bool idle() { return sendBase == sendNext; }
+  bool peerFull() { return sendNext > sendLimit; }
+
+  Acceptance accept(long, const char*, int);
+  Segment* nextDeliverable();
+  void delivered(Segment*);
+  long getCumulative() { return receivedThrough; }
+  uint32_t getSelective();
+  //Segments past getCumulative() there is room for, undelivered ones take room
+  int getRoom() { return deliveredThrough + WINDOW_SIZE - receivedThrough; }
+
+  uint32_t getRto() { return rto; }
+  int getRetransmitCount() { return retransmitCount; }
+  int getDuplicateCount() { return duplicateCount; }
+
+private:
+  //Send side: sequence numbers [sendBase, sendNext) are unacknowledged, and
+  //the peer has room for sequence numbers through sendLimit
+  Segment sendSlots[WINDOW_SIZE];
+  long sendBase;
+  long sendNext;
+  long sendLimit;
+
+  //Receive side: everything through deliveredThrough was handed to the
+  //stream, everything through receivedThrough is held or delivered
+  Segment receiveSlots[WINDOW_SIZE];
+  long deliveredThrough;
+  long receivedThrough;
+
+  //Smoothed RTT scaled by 8 and its variance scaled by 4, as in TCP
+  uint32_t smoothedRtt;
+  uint32_t rttVariance;
+  uint32_t rto;
+
+  int retransmitCount = 0;
+  int duplicateCount = 0;
+
+  void sampleRtt(uint32_t);
+};
@@ -0,0 +1,101 @@
+/**
+ * The Flying Squirrels: Squirrel Lighting Controller
+ * Purpose: Client side cache for identity lookups against the registrar hub
+ * Date:    2026-10-17
+ */
+
+#include "NameResolver.h"
+
+/**
+ * Looks up the address registered for a name. A cached answer, including
+ * "unknown", returns right away. Otherwise the hub is asked with "ip <name>",
+ * waiting up to the hub stream's timeout.
+ * 
+ * @return  The address, 0.0.0.0 if the name is unknown or the hub did not answer.
+ */
+IPAddress NameResolver::resolve(const char* name) {
+  Entry* entry = find(name);
+  if (entry && millis() - entry->storedAt < entry->ttl) {
+    hitCount++;
+    return IPAddress(entry->ip);
+  }
+  missCount++;
+
+  hub->printf("ip %s\n", name);
+  hub->flush();
+  String reply = hub->readStringUntil('\n');
+
+  //No answer says nothing about the name, so it is not cached
+  IPAddress ip;
+  if (!ip.fromString(reply))
+    return IPAddress(0, 0, 0, 0);
+
+  store(name, ip, uint32_t(ip) == 0 ? negativeTtl : ttl);
+  return ip;
+}
+
+/**
+ * Replaces the cached address for a name, as pushed by the hub when the name
+ * registers. 0.0.0.0 caches the name as unknown.
+ */
+void NameResolver::update(const char* name, IPAddress ip) {
+  store(name, ip, uint32_t(ip) == 0 ? negativeTtl : ttl);
+}
+
+/**
+ * Forgets a name, so the next resolve() asks the hub. Use this when the
+ * address stops answering.
+ */
+void NameResolver::invalidate(const char* name) {
+  Entry* entry = find(name);
+  if (entry)
+    entry->used = false;
+}
+
+void NameResolver::invalidateAll() {
+  for (int i = 0; i < CACHE_SIZE; i++)
+    entries[i].used = false;
+}
+
+/**
+ * @param positive  mS a known address is trusted.
+ * @param negative  mS an unknown name is not asked about again.
+ */
+void NameResolver::setTtl(uint32_t positive, uint32_t negative) {
+  ttl = positive;
+  negativeTtl = negative;
+}
+
+NameResolver::Entry* NameResolver::find(const char* name) {
+  for (int i = 0; i < CACHE_SIZE; i++) {
+    if (entries[i].used && strncmp(entries[i].name, name, NAME_LENGTH) == 0)
+      return &entries[i];
+  }
+  return NULL;
+}
+
+/**
+ * Caches an answer, in the name's own entry, a free one, or the oldest.
+ */
+void NameResolver::store(const char* name, IPAddress ip, uint32_t lifetime) {
+  uint32_t now = millis();
+  Entry* entry = find(name);
+  for (int i = 0; !entry && i < CACHE_SIZE; i++) {
+    if (!entries[i].used)
+      entry = &entries[i];
+  }
+  if (!entry) {
+    entry = &entries[0];
+    for (int i = 1; i < CACHE_SIZE; i++) {
+      if (now - entries[i].storedAt > now - entry->storedAt)
+        entry = &entries[i];
+    }
+  }
+
+  strncpy(entry->name, name, NAME_LENGTH);
+  entry->name[NAME_LENGTH] = '\0';
+  entry->ip = uint32_t(ip);
+  entry->storedAt = now;
+  entry->ttl = lifetime;
+  entry->used = true;
+}
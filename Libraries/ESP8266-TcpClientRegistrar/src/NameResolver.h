@@ -0,0 +1,49 @@
+/**
+ * The Flying Squirrels: Squirrel Lighting Controller
+ * Purpose: Client side cache for identity lookups against the registrar hub
+ * Date:    2026-10-17
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <IPAddress.h>
+
+class NameResolver {
+
+public:
+  static const int CACHE_SIZE = 8;            //Names remembered at once
+  static const int NAME_LENGTH = 16;          //Same limit as the registrar
+  static const uint32_t TTL = 60000;          //mS a known address is trusted
+  static const uint32_t NEGATIVE_TTL = 5000;  //mS an unknown name is not asked again
+
+  NameResolver(Stream& hub) : hub(&hub) {}
+
+  IPAddress resolve(const char*);
+  void update(const char*, IPAddress);
+  void invalidate(const char*);
+  void invalidateAll();
+  void setTtl(uint32_t, uint32_t);
+
+  int getHitCount() { return hitCount; }
+  int getMissCount() { return missCount; }
+
+private:
+  struct Entry {
+    char name[NAME_LENGTH + 1];
+    uint32_t ip;
+    uint32_t storedAt;
+    uint32_t ttl;
+    bool used;
+  };
+
+  Stream* hub;
+  Entry entries[CACHE_SIZE] = {};
+  uint32_t ttl = TTL;
+  uint32_t negativeTtl = NEGATIVE_TTL;
+  int hitCount = 0;
+  int missCount = 0;
+
+  Entry* find(const char*);
+  void store(const char*, IPAddress, uint32_t);
+};
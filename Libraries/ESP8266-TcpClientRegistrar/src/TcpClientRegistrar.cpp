@@ -8,6 +8,10 @@
 #include "TcpClientRegistrar.h"
 
 TcpClientRegistrar::TcpClientRegistrar() {
+  for (int i = 0; i < ID_MAX_REG_COUNT; i++)
+    registrar[i * (ID_LENGTH + 1)] = '\0';
+  for (int i = 0; i < INDEX_SIZE; i++)
+    registrarIndex[i] = -1;
 }
 
 int TcpClientRegistrar::assign(char* identity, WiFiClient** clientPointerAddress) {
@@ -53,51 +57,175 @@ int TcpClientRegistrar::getConnectionTimeout() {
   return idWaitCount;
 }
 
+/**
+ * @return  The address last registered under the identity, 0.0.0.0 if none.
+ */
 IPAddress TcpClientRegistrar::findIp(const char* identity) {
 
-  for (int index = 0; index < ID_MAX_REG_COUNT; index++) {
-    const char* viewing = (const char*)&registrar[index * (ID_LENGTH + 1)];
-    if (strcmp(viewing, identity) == 0) {
-      return IPAddress(registrarIps[index]);
-    }
-  }
+  int slot = findSlot(identity, hashIdentity(identity));
+  if (slot < 0)
+    return IPAddress(0, 0, 0, 0);
   
-  return IPAddress(0, 0, 0, 0);
+  registrarUsed[slot] = millis();
+  return IPAddress(registrarIps[slot]);
+}
+
+/**
+ * @return  The service port the identity last announced, 0 if it registered
+ *          over TCP or is unknown.
+ */
+uint16_t TcpClientRegistrar::findPort(const char* identity) {
+  int slot = findSlot(identity, hashIdentity(identity));
+  return slot < 0 ? 0 : registrarPorts[slot];
+}
+
+/**
+ * @return  millis() when the identity last registered, 0 if it is unknown.
+ */
+uint32_t TcpClientRegistrar::getLastSeen(const char* identity) {
+  int slot = findSlot(identity, hashIdentity(identity));
+  return slot < 0 ? 0 : registrarSeen[slot];
+}
+
+/**
+ * Calls the given function whenever an identity registers with a new address,
+ * or is forgotten (with 0.0.0.0) to make room. Clients caching lookups can be
+ * told from there.
+ */
+void TcpClientRegistrar::onChange(void (*handler)(const char*, IPAddress)) {
+  changeHandler = handler;
+}
+
+/**
+ * Private
+ * FNV-1a over the identity, as stored (at most ID_LENGTH chars).
+ */
+uint32_t TcpClientRegistrar::hashIdentity(const char* identity) {
+  uint32_t hash = 2166136261UL;
+  for (int i = 0; identity[i] != '\0' && i < ID_LENGTH; i++) {
+    hash ^= (uint8_t)identity[i];
+    hash *= 16777619UL;
+  }
+  return hash;
 }
 
 /**
  * Private
- * Registers an identity with an IP address.
+ * Looks an identity up in the hash index. Like the stored names, only the
+ * first ID_LENGTH chars count.
  * 
- * TO-DO: Set priority indexes based on past retrievals. 
- *        Overwrite rather than filling up. Security flaw!
+ * @return  The registrar slot, -1 if the identity is not registered.
  */
-void TcpClientRegistrar::setIp(const char* identity, IPAddress ip) {
+int TcpClientRegistrar::findSlot(const char* identity, uint32_t hash) {
+  if (identity[0] == '\0')
+    return -1;
+  
+  for (int i = 0, position = hash % INDEX_SIZE; i < INDEX_SIZE; i++, position = (position + 1) % INDEX_SIZE) {
+    int slot = registrarIndex[position];
+    if (slot < 0)
+      return -1;
+    if (registrarHashes[slot] == hash
+        && strncmp((const char*)&registrar[slot * (ID_LENGTH + 1)], identity, ID_LENGTH) == 0)
+      return slot;
+  }
+  return -1;
+}
 
-  int index = 0;
-  for (; index < ID_MAX_REG_COUNT; index++) {
-    const char* viewing = (const char*)&registrar[index * (ID_LENGTH + 1)];
-    if (viewing[0] == '\0' || strcmp(viewing, identity) == 0)
-      break;
+/**
+ * Private
+ * Removes a slot from the hash index, moving later entries of the same probe
+ * sequence back so that lookups never stop early at the gap.
+ */
+void TcpClientRegistrar::unindex(int slot) {
+  int position = registrarHashes[slot] % INDEX_SIZE;
+  while (registrarIndex[position] != slot)
+    position = (position + 1) % INDEX_SIZE;
+
+  int gap = position;
+  for (int next = (gap + 1) % INDEX_SIZE; registrarIndex[next] >= 0; next = (next + 1) % INDEX_SIZE) {
+    int home = registrarHashes[registrarIndex[next]] % INDEX_SIZE;
+    //Move the entry back if its home is not between the gap and where it sits
+    bool between = gap <= next ? (gap < home && home <= next) : (gap < home || home <= next);
+    if (!between) {
+      registrarIndex[gap] = registrarIndex[next];
+      gap = next;
+    }
   }
+  registrarIndex[gap] = -1;
+}
+
+/**
+ * Private
+ * Registers an identity with an IP address. When all slots are taken, the
+ * identity registered or looked up longest ago makes room. A port of 0
+ * leaves an announced port as it was.
+ */
+void TcpClientRegistrar::setIp(const char* identity, IPAddress ip, uint16_t port) {
 
-  //NO MORE ADDRESSES
-  if (index >= ID_MAX_REG_COUNT)
+  if (identity[0] == '\0')
     return;
 
-  //Copy identity (first chars)
-  for (int i = 0; i < ID_LENGTH; i++) {
-    registrar[(index * (ID_LENGTH + 1)) + i] = identity[i];
-    registrar[(index * (ID_LENGTH + 1)) + i + 1] = '\0';
+  uint32_t now = millis();
+  uint32_t hash = hashIdentity(identity);
+  int index = findSlot(identity, hash);
+
+  if (index < 0) {
+    if (registrarCount < ID_MAX_REG_COUNT) {
+      index = registrarCount++;
+    } else {
+      //Evict the least recently used identity
+      index = 0;
+      for (int i = 1; i < ID_MAX_REG_COUNT; i++) {
+        if (now - registrarUsed[i] > now - registrarUsed[index])
+          index = i;
+      }
+      Serial.print("DEBUG: Registrar full, forgetting ");
+      Serial.print((const char*)&registrar[index * (ID_LENGTH + 1)]);
+      Serial.print("\n");
+      if (changeHandler)
+        changeHandler((const char*)&registrar[index * (ID_LENGTH + 1)], IPAddress(0, 0, 0, 0));
+      unindex(index);
+    }
+
+    //Copy identity (first chars)
+    for (int i = 0; i < ID_LENGTH; i++) {
+      registrar[(index * (ID_LENGTH + 1)) + i] = identity[i];
+      registrar[(index * (ID_LENGTH + 1)) + i + 1] = '\0';
+      if (identity[i] == '\0')
+        break;
+    }
+    registrarHashes[index] = hash;
+    registrarPorts[index] = port;
+
+    int position = hash % INDEX_SIZE;
+    while (registrarIndex[position] >= 0)
+      position = (position + 1) % INDEX_SIZE;
+    registrarIndex[position] = index;
+  } else if (registrarIps[index] == uint32_t(ip)) {
+    if (port != 0)
+      registrarPorts[index] = port;
+    registrarSeen[index] = now;
+    registrarUsed[index] = now;
+    return;
   }
   
   registrarIps[index] = uint32_t(ip);
+  if (port != 0)
+    registrarPorts[index] = port;
+  registrarSeen[index] = now;
+  registrarUsed[index] = now;
+  if (changeHandler)
+    changeHandler((const char*)&registrar[index * (ID_LENGTH + 1)], ip);
 }
 
 /**
  * Handle any incoming client connections on the given server, and automatically
  * determine the identity and address the client to the right pointer. 
  * An existing connection with the same identity will be closed. 
+ * 
+ * Nothing here waits on a client. Each call moves every handshake in progress
+ * along as far as the data already received allows, and gives up on a stage
+ * that passes its deadline.
  */
 void TcpClientRegistrar::handle(WiFiServer& listenServer) {
 
@@ -112,66 +240,191 @@ void TcpClientRegistrar::handle(WiFiServer& listenServer) {
     }
   }
 
-  //Find new clients
-  WiFiClient newClient = listenServer.available();
-  if (!newClient)
+  //Take a new client if there is room, otherwise it waits in the listen queue
+  for (int i = 0; i < HANDSHAKE_MAX_COUNT; i++) {
+    if (handshakes[i].stage != STAGE_FREE)
+      continue;
+    WiFiClient newClient = listenServer.available();
+    if (newClient) {
+      newClient.setNoDelay(true);
+      handshakes[i].client = newClient;
+      startStage(handshakes[i], STAGE_OPENING);
+    }
+    break;
+  }
+
+  for (int i = 0; i < HANDSHAKE_MAX_COUNT; i++) {
+    if (handshakes[i].stage != STAGE_FREE)
+      advance(handshakes[i]);
+  }
+}
+
+/**
+ * Registers nodes from the announcements waiting on the given socket, which
+ * should be bound to ANNOUNCE_PORT. An announcement is one datagram, 
+ * "announce <identity> <port> <version>\n", and is answered straight back
+ * with "registered <identity>\n". Announcements of a newer version than this
+ * hub understands are ignored, so the node can fall back to TCP.
+ */
+void TcpClientRegistrar::handleAnnounce(WiFiUDP& udp) {
+
+  char packet[ANNOUNCE_LENGTH + 1];
+  while (udp.parsePacket() > 0) {
+    int length = udp.read(packet, ANNOUNCE_LENGTH);
+    if (length < 9)
+      continue;
+    packet[length] = '\0';
+    if (strncmp(packet, "announce ", 9) != 0)
+      continue;
+
+    //Split out the identity, then the port and version numbers
+    char* identity = &packet[9];
+    char* end = strchr(identity, ' ');
+    if (end == NULL || end == identity || end - identity > ID_LENGTH)
+      continue;
+    *end = '\0';
+    char* versionText;
+    unsigned long port = strtoul(end + 1, &versionText, 10);
+    long version = strtol(versionText, NULL, 10);
+    if (port == 0 || port > 65535 || version < 1 || version > ANNOUNCE_VERSION)
+      continue;
+
+    Serial.print("DEBUG: Announced client has identity=\"");
+    Serial.print(identity);
+    Serial.print("\"\n");
+    setIp(identity, udp.remoteIP(), port);
+
+    udp.beginPacket(udp.remoteIP(), udp.remotePort());
+    udp.print("registered ");
+    udp.print(identity);
+    udp.print("\n");
+    udp.endPacket();
+  }
+}
+
+/**
+ * Private
+ * Moves one handshake along: wait for the connection to open, discard any
+ * initial data, then ask for the mode and the identity.
+ */
+void TcpClientRegistrar::advance(Handshake& handshake) {
+  WiFiClient& client = handshake.client;
+  uint32_t elapsed = millis() - handshake.stageStart;
+
+  if (handshake.stage == STAGE_OPENING) {
+    if (client.connected())
+      startStage(handshake, flushDelay > 0 ? STAGE_FLUSHING : STAGE_MODE);
+    else if (elapsed >= OPEN_TIMEOUT)
+      drop(handshake);
     return;
+  }
 
-  //TO-DO Allow setting this timeout (default to 20mS)
-  //Wait for the new connection to open, fail after timeout
-  newClient.setNoDelay(true);
-  for (int i = 0; !newClient.connected() && i < 250; i++)
-    delay(1);
-  if (!newClient.connected()) {
-    newClient.stop();
+  if (!client.connected() && client.available() <= 0) {
+    drop(handshake);
     return;
   }
 
-  //Catch and discard any initial crap
-  if (flushDelay > 0) {
-    delay(flushDelay);
-    while (newClient.available()) {
-      newClient.flush();
-      delay(flushDelay);
+  switch (handshake.stage) {
+  case STAGE_FLUSHING:
+    //Catch and discard any initial crap, until the client is quiet for flushDelay
+    if (client.available() > 0) {
+      while (client.available() > 0)
+        client.read();
+      handshake.stageStart = millis();
+    } else if (elapsed >= flushDelay)
+      startStage(handshake, STAGE_MODE);
+    break;
+
+  case STAGE_MODE:
+    if (!readReply(handshake))
+      break;
+    if (!handshake.tooLong && strcmp(handshake.reply, "persist") == 0)
+      handshake.persist = true;
+    else if (!handshake.tooLong && strcmp(handshake.reply, "register") == 0)
+      handshake.persist = false;
+    else {
+      drop(handshake);
+      break;
     }
+    startStage(handshake, STAGE_IDENTIFY);
+    break;
+
+  case STAGE_IDENTIFY:
+    if (!readReply(handshake))
+      break;
+    if (handshake.tooLong || handshake.replyLength == 0)
+      drop(handshake);
+    else
+      finish(handshake);
+    break;
+
+  default:
+    break;
   }
+}
 
-  //Get the mode from the client
-  newClient.setTimeout(idWaitCount);
-  newClient.print("mode\n");
-  String clientMode = newClient.readStringUntil('\n');
-  clientMode.replace("\r", "");
-  newClient.setTimeout(0);
-
-  int clientModeVal = 0;
-  if (clientMode.equals("persist"))
-    clientModeVal = 0;
-  else if (clientMode.equals("register"))
-    clientModeVal = 1;
-  else {
-    newClient.stop();
-    return;
+/**
+ * Private
+ * Enters a stage, sending the query the client has to answer in it.
+ */
+void TcpClientRegistrar::startStage(Handshake& handshake, Stage stage) {
+  handshake.stage = stage;
+  handshake.stageStart = millis();
+  handshake.replyLength = 0;
+  handshake.reply[0] = '\0';
+  handshake.tooLong = false;
+
+  if (stage == STAGE_MODE)
+    handshake.client.print("mode\n");
+  else if (stage == STAGE_IDENTIFY)
+    handshake.client.print("identify\n");
+}
+
+/**
+ * Private
+ * Collects the reply to the current query from whatever has arrived. Carriage
+ * returns are ignored.
+ * 
+ * @return  True once the line is complete, or the connection timeout ran out,
+ *          in which case the reply holds what arrived so far.
+ */
+bool TcpClientRegistrar::readReply(Handshake& handshake) {
+  WiFiClient& client = handshake.client;
+  while (client.available() > 0) {
+    int c = client.read();
+    if (c == '\n')
+      return true;
+    if (c == '\r' || c < 0)
+      continue;
+    if (handshake.replyLength >= REPLY_LENGTH) {
+      handshake.tooLong = true;
+      continue;
+    }
+    handshake.reply[handshake.replyLength++] = (char)c;
+    handshake.reply[handshake.replyLength] = '\0';
   }
+  return millis() - handshake.stageStart >= (uint32_t)idWaitCount;
+}
 
-  //Get the identity from the client
-  newClient.setTimeout(idWaitCount);
-  newClient.print("identify\n");
-  String clientId = newClient.readStringUntil('\n');
-  clientId.replace("\r", "");
-  newClient.setTimeout(0);
+/**
+ * Private
+ * Registers an identified client, and hands a persistent one to its pointer.
+ */
+void TcpClientRegistrar::finish(Handshake& handshake) {
+  const char* clientId = handshake.reply;
 
-  if (clientModeVal == 0)
-    Serial.print("DEBUG: Persistent client has identity=\"");
-  else
+  if (!handshake.persist)
     Serial.print("DEBUG: Registering client has identity=\"");
+  else
+    Serial.print("DEBUG: Persistent client has identity=\"");
   Serial.print(clientId);
   Serial.print("\"\n");
 
   //Register this client in the lookup table
-  setIp(clientId.c_str(), newClient.remoteIP());
+  setIp(clientId, handshake.client.remoteIP());
 
-  if (clientModeVal == 1) {
-    newClient.stop();
+  if (!handshake.persist) {
+    drop(handshake);
     return;
   }
   
@@ -180,7 +433,7 @@ void TcpClientRegistrar::handle(WiFiServer& listenServer) {
     const char* name = (const char*)&identities[i * (ID_LENGTH + 1)];
     WiFiClient** clientAdd = clients[i];
     
-    if (clientId.equals(name)) {
+    if (strcmp(clientId, name) == 0) {
       if (*clientAdd) {
         Serial.print("DEBUG: Closing previous connection for ");
         Serial.print(name);
@@ -188,11 +441,25 @@ void TcpClientRegistrar::handle(WiFiServer& listenServer) {
         (*clientAdd)->stop();
         delete (*clientAdd);
       }
-      (*clientAdd) = new WiFiClient(newClient);
-      break;
+      (*clientAdd) = new WiFiClient(handshake.client);
+      
+      //The pointer holds the connection now, only let go of our copy
+      handshake.client = WiFiClient();
+      handshake.stage = STAGE_FREE;
+      return;
     }
   }
-  newClient.stop();
+  drop(handshake);
+}
+
+/**
+ * Private
+ * Closes the connection and frees the handshake slot.
+ */
+void TcpClientRegistrar::drop(Handshake& handshake) {
+  handshake.client.stop();
+  handshake.client = WiFiClient();
+  handshake.stage = STAGE_FREE;
 }
 
 bool TcpClientRegistrar::connectClient(WiFiClient& server, IPAddress ip, uint16_t port, const char* identity, bool persist) {
@@ -263,6 +530,92 @@ bool TcpClientRegistrar::connectClient(WiFiClient& server, IPAddress ip, uint16_
   }
 }
 
+/**
+ * Registers with any hub in the broadcast domain by UDP announcement instead
+ * of a TCP handshake, waiting for the answer. See Announcement, which does the
+ * same without holding up the loop.
+ * 
+ * @param udp       Socket bound to ANNOUNCE_PORT
+ * @param broadcast Broadcast address of the network, or the hub itself
+ * @param identity  Name to register
+ * @param port      Port the node serves its commands on
+ * @param timeout   mS to wait for an acknowledgement. Default=250.
+ * @return  True once a hub has registered the node.
+ */
+bool TcpClientRegistrar::announce(WiFiUDP& udp, IPAddress broadcast, const char* identity, uint16_t port, uint16_t timeout) {
+
+  Announcement announcement;
+  announcement.begin(udp, broadcast, identity, port, timeout);
+  while (announcement.poll() == Announcement::ANNOUNCING)
+    delay(1);
+  return announcement.getState() == Announcement::REGISTERED;
+}
+
+/**
+ * Starts announcing the node. The announcement is sent right away, and
+ * repeated every 50 mS by poll() until a hub acknowledges it or the timeout
+ * runs out. The socket must be bound to ANNOUNCE_PORT to hear the
+ * acknowledgement.
+ * 
+ * @param udp       Socket bound to ANNOUNCE_PORT
+ * @param broadcast Broadcast address of the network, or the hub itself
+ * @param identity  Name to register
+ * @param port      Port the node serves its commands on
+ * @param timeout   mS to wait for an acknowledgement. Default=250.
+ */
+void TcpClientRegistrar::Announcement::begin(WiFiUDP& udp, IPAddress broadcast, const char* identity, uint16_t port, uint16_t timeout) {
+
+  this->udp = &udp;
+  this->broadcast = broadcast;
+  strncpy(this->identity, identity, ID_LENGTH);
+  this->identity[ID_LENGTH] = '\0';
+  this->port = port;
+  this->timeout = timeout;
+  startedAt = millis();
+  sentAt = startedAt - ANNOUNCE_RETRY;
+  state = ANNOUNCING;
+  poll();
+}
+
+/**
+ * Resends the announcement if it is due and takes in any acknowledgement,
+ * without waiting.
+ * 
+ * @return  ANNOUNCING until a hub has registered the node (REGISTERED) or the
+ *          timeout ran out (TIMED_OUT).
+ */
+TcpClientRegistrar::Announcement::State TcpClientRegistrar::Announcement::poll() {
+
+  if (state != ANNOUNCING)
+    return state;
+
+  char expected[ANNOUNCE_LENGTH + 1];
+  snprintf(expected, sizeof(expected), "registered %s\n", identity);
+  int expectedLength = strlen(expected);
+  char packet[ANNOUNCE_LENGTH + 1];
+
+  //Other nodes' announcements arrive here too, only an ack counts
+  while (udp->parsePacket() > 0) {
+    int length = udp->read(packet, ANNOUNCE_LENGTH);
+    if (length == expectedLength && strncmp(packet, expected, length) == 0) {
+      state = REGISTERED;
+      return state;
+    }
+  }
+
+  if (millis() - startedAt >= timeout) {
+    state = TIMED_OUT;
+    return state;
+  }
+  if (millis() - sentAt >= ANNOUNCE_RETRY) {
+    udp->beginPacket(broadcast, ANNOUNCE_PORT);
+    udp->printf("announce %s %u %i\n", identity, port, ANNOUNCE_VERSION);
+    udp->endPacket();
+    sentAt = millis();
+  }
+  return state;
+}
+
 /**
  * All nodes using the command interpreter should respond to a command that 
  * consts only of "____" with the response being non-blank.
@@ -279,8 +632,3 @@ bool TcpClientRegistrar::probeConnection(WiFiClient& client, uint16_t timeout) {
   
   return !response.equals("");
 }
-
-
-
-
-
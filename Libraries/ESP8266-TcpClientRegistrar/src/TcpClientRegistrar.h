@@ -10,6 +10,7 @@
 #include <ESP8266HTTPClient.h>
 #include <WiFiServer.h>
 #include <WiFiClient.h>
+#include <WiFiUdp.h>
 
 //Directly link to ESP SDK
 extern "C" {
@@ -24,21 +25,102 @@ private:
   static const int ID_MAX_REG_COUNT = 64;  //64 registered ip-name links
   char registrar[ID_MAX_REG_COUNT * (ID_LENGTH + 1)];
   uint32_t registrarIps[ID_MAX_REG_COUNT];
+  uint32_t registrarHashes[ID_MAX_REG_COUNT];
+  uint32_t registrarSeen[ID_MAX_REG_COUNT];  //millis() of the last registration
+  uint32_t registrarUsed[ID_MAX_REG_COUNT];  //millis() of the last registration or lookup
+  uint16_t registrarPorts[ID_MAX_REG_COUNT]; //Announced service port, 0 if registered by TCP
+  int registrarCount = 0;
 
-  uint16_t flushDelay;
+  //Open addressing index of registrar slots by identity hash, -1 if empty.
+  //Twice the slots keeps probe sequences short.
+  static const int INDEX_SIZE = 2 * ID_MAX_REG_COUNT;
+  int8_t registrarIndex[INDEX_SIZE];
+  void (*changeHandler)(const char*, IPAddress) = NULL;
+
+  uint16_t flushDelay = 0;
 
   char identities[ID_MAX_COUNT * (ID_LENGTH + 1)];
   WiFiClient** clients[ID_MAX_COUNT];
   int idCount = 0;
   int idWaitCount = 100;
 
-  void setIp(const char*, IPAddress);
+  static const int HANDSHAKE_MAX_COUNT = 4; //Clients identified at once, others wait to be accepted
+  static const uint32_t OPEN_TIMEOUT = 250; //mS for a new connection to finish opening
+  static const int REPLY_LENGTH = 24;       //Longest mode or identity reply
+
+  //Steps of identifying a new client, each advanced without waiting
+  enum Stage {
+    STAGE_FREE,
+    STAGE_OPENING,
+    STAGE_FLUSHING,
+    STAGE_MODE,
+    STAGE_IDENTIFY
+  };
+
+  struct Handshake {
+    WiFiClient client;
+    Stage stage = STAGE_FREE;
+    uint32_t stageStart = 0;
+    bool persist = false;
+    bool tooLong = false;
+    uint8_t replyLength = 0;
+    char reply[REPLY_LENGTH + 1];
+  };
+  Handshake handshakes[HANDSHAKE_MAX_COUNT];
+
+  static const uint32_t ANNOUNCE_RETRY = 50; //mS between unanswered announcements
+  static const int ANNOUNCE_LENGTH = 48;     //Longest announcement or acknowledgement
+
+  void setIp(const char*, IPAddress, uint16_t = 0);
+  int findSlot(const char*, uint32_t);
+  void unindex(int);
+  static uint32_t hashIdentity(const char*);
+  void advance(Handshake&);
+  bool readReply(Handshake&);
+  void startStage(Handshake&, Stage);
+  void finish(Handshake&);
+  void drop(Handshake&);
   
 public: 
+  static const uint16_t ANNOUNCE_PORT = 25; //UDP port the hub hears announcements on
+  static const int ANNOUNCE_VERSION = 1;    //Newest announcement format understood
+
+  //A node's announcement, resent and checked for an acknowledgement each time
+  //it is polled, so the node's loop keeps running while it waits
+  class Announcement {
+  public:
+    enum State {
+      IDLE,
+      ANNOUNCING,
+      REGISTERED,
+      TIMED_OUT
+    };
+
+    void begin(WiFiUDP&, IPAddress, const char*, uint16_t, uint16_t = 250);
+    State poll();
+    State getState() { return state; }
+    void reset() { state = IDLE; }
+
+  private:
+    WiFiUDP* udp = NULL;
+    IPAddress broadcast;
+    char identity[ID_LENGTH + 1];
+    uint16_t port = 0;
+    uint16_t timeout = 0;
+    uint32_t startedAt = 0;
+    uint32_t sentAt = 0;
+    State state = IDLE;
+  };
+
   TcpClientRegistrar();
   void handle(WiFiServer&);
+  void handleAnnounce(WiFiUDP&);
   int assign(char*, WiFiClient**);
   IPAddress findIp(const char*);
+  uint16_t findPort(const char*);
+  uint32_t getLastSeen(const char*);
+  int getRegisteredCount() { return registrarCount; }
+  void onChange(void (*)(const char*, IPAddress));
   void enableInitialFlush(int = 20);
   void disableInitialFlush();
   void setConnectionTimeout(int);
@@ -47,6 +129,7 @@ public:
   static bool connectClient(
       WiFiClient&, IPAddress, uint16_t, const char*, bool = true);
   static bool probeConnection(WiFiClient&, uint16_t = 0);
+  static bool announce(WiFiUDP&, IPAddress, const char*, uint16_t, uint16_t = 250);
 };
 
 /**
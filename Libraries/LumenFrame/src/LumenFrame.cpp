@@ -0,0 +1,291 @@
+/**
+ * The Flying Squirrels: Squirrel Lighting Controller
+ * Purpose: Encode and decode the frames iocontrol broadcasts to the lumens,
+ *          as text or fixed width binary
+ * Date:    2026-10-17
+ */
+
+#include "LumenFrame.h"
+
+LumenFrame::LumenFrame(uint16_t session) {
+  memset(binary, 0, sizeof(binary));
+  binary[0] = BINARY_MAGIC;
+  for (int i = 0; i < MAX_SLOTS; i++) {
+    lineLengths[i] = 0;
+    lineStale[i] = false;
+  }
+  setSession(session);
+}
+
+/**
+ * Sets the session named in every frame. Lumens ignore frames of a session
+ * other than the one they were given with their slot.
+ */
+void LumenFrame::setSession(uint16_t session) {
+  this->session = session;
+  binary[1] = session >> 8;
+  binary[2] = session & 0xFF;
+  textStale = true;
+  changed = true;
+}
+
+/**
+ * Sets how many slots the frame carries, from slot 0 up.
+ */
+void LumenFrame::setSlotCount(int count) {
+  count = count < 0 ? 0 : (count > MAX_SLOTS ? MAX_SLOTS : count);
+  if (count == slotCount)
+    return;
+  slotCount = count;
+  binary[3] = count;
+  textStale = true;
+  changed = true;
+}
+
+/**
+ * Sets a slot to a lumen command, as it would be sent on its own.
+ * 
+ * @param slot     The slot to change
+ * @param command  'c' (red green blue [white] [warm]) or 't' (temp [brightness]),
+ *                 0 leaves the lumen in the slot as it is
+ * @param values   The command's arguments
+ * @param count    Number of values
+ * @return  True if the slot changed.
+ */
+bool LumenFrame::set(int slot, char command, const uint8_t* values, int count) {
+  if (slot < 0 || slot >= MAX_SLOTS || count > MAX_CHANNELS)
+    return false;
+  if ((command == 'c' && count < 3) || (command == 't' && count < 1))
+    return false;
+  if (command != 'c' && command != 't')
+    command = 0;
+
+  //Omitted channels are 0, except brightness which is full
+  uint8_t fields[BINARY_SLOT_SIZE] = {(uint8_t)command};
+  for (int i = 0; command != 0 && i < count; i++)
+    fields[1 + i] = values[i];
+  if (command == 't' && count < 2)
+    fields[2] = 255;
+
+  uint8_t* current = &binary[BINARY_HEADER_SIZE + slot * BINARY_SLOT_SIZE];
+  if (memcmp(current, fields, BINARY_SLOT_SIZE) == 0)
+    return false;
+  memcpy(current, fields, BINARY_SLOT_SIZE);
+
+  lineStale[slot] = true;
+  if (slot < slotCount) {
+    textStale = true;
+    changed = true;
+  }
+  return true;
+}
+
+/**
+ * Returns the frame as text, "f <session>" and then one command line per
+ * slot. Only the lines of slots that changed are formatted again.
+ * 
+ * @param length  Set to the number of chars in the frame
+ */
+const char* LumenFrame::encodeText(int& length) {
+  if (textStale) {
+    int position = 0;
+    text[position++] = 'f';
+    text[position++] = ' ';
+    position += formatDecimal(&text[position], session);
+    text[position++] = '\n';
+
+    for (int i = 0; i < slotCount; i++) {
+      if (lineStale[i])
+        encodeLine(i);
+      memcpy(&text[position], lines[i], lineLengths[i]);
+      position += lineLengths[i];
+      text[position++] = '\n';
+    }
+    textLength = position;
+    textStale = false;
+  }
+
+  changed = false;
+  length = textLength;
+  return text;
+}
+
+/**
+ * Returns the frame as fixed width binary, the magic byte, the session (high
+ * byte first) and the slot count, then per slot the command char (0 for
+ * none) and 5 channel values.
+ * 
+ * @param length  Set to the number of bytes in the frame
+ */
+const uint8_t* LumenFrame::encodeBinary(int& length) {
+  changed = false;
+  length = BINARY_HEADER_SIZE + slotCount * BINARY_SLOT_SIZE;
+  return binary;
+}
+
+/**
+ * Private
+ * Formats a slot's command line, leaving out trailing channels that are 0.
+ */
+void LumenFrame::encodeLine(int slot) {
+  const uint8_t* fields = &binary[BINARY_HEADER_SIZE + slot * BINARY_SLOT_SIZE];
+  char* line = lines[slot];
+  int length = 0;
+
+  if (fields[0] != 0) {
+    int count = fields[0] == 't' ? 2 : MAX_CHANNELS;
+    while (fields[0] == 'c' && count > 3 && fields[count] == 0)
+      count--;
+
+    line[length++] = fields[0];
+    for (int i = 1; i <= count; i++) {
+      line[length++] = ' ';
+      length += formatDecimal(&line[length], fields[i]);
+    }
+  }
+  lineLengths[slot] = length;
+  lineStale[slot] = false;
+}
+
+/**
+ * Writes a number in decimal, without printf.
+ * 
+ * @return  The number of chars written, at most 5. No terminator is added.
+ */
+int LumenFrame::formatDecimal(char* out, uint16_t value) {
+  char digits[5];
+  int count = 0;
+  do {
+    digits[count++] = '0' + value % 10;
+    value /= 10;
+  } while (value > 0);
+
+  for (int i = 0; i < count; i++)
+    out[i] = digits[count - 1 - i];
+  return count;
+}
+
+/**
+ * Picks one slot's command out of a text or binary frame.
+ * 
+ * @param data     The frame datagram
+ * @param length   Bytes in the datagram
+ * @param session  Session the slot was given with
+ * @param slot     The slot to read
+ * @param command  Set to 'c' or 't'
+ * @param channels Set to the command's arguments, room for MAX_CHANNELS
+ * @param count    Set to the number of arguments
+ * @return  False if the frame is of another session, malformed, or leaves
+ *          the slot as it is.
+ */
+bool LumenFrame::decode(const uint8_t* data, int length, uint16_t session, int slot,
+    char& command, uint8_t* channels, int& count) {
+
+  if (length < 1 || slot < 0)
+    return false;
+  if (data[0] != BINARY_MAGIC)
+    return decodeText((const char*)data, (const char*)data + length, session, slot, command, channels, count);
+
+  if (length < BINARY_HEADER_SIZE || ((data[1] << 8) | data[2]) != session || slot >= data[3]
+      || length < BINARY_HEADER_SIZE + (slot + 1) * BINARY_SLOT_SIZE)
+    return false;
+
+  const uint8_t* fields = &data[BINARY_HEADER_SIZE + slot * BINARY_SLOT_SIZE];
+  if (fields[0] != 'c' && fields[0] != 't')
+    return false;
+  command = fields[0];
+  count = command == 't' ? 2 : MAX_CHANNELS;
+  memcpy(channels, &fields[1], count);
+  return true;
+}
+
+/**
+ * Reads the next waiting frame datagram from socket, if any, and picks one
+ * slot's command out of it, with the values as command arguments ready for
+ * the bulb's c or t handler.
+ * 
+ * @param socket   Socket bound to the frame port
+ * @param session  Session the slot was given with
+ * @param slot     The slot to read, negative if none was given yet
+ * @param command  Set to 'c' or 't'
+ * @param argv     Set to the command's arguments, room for MAX_CHANNELS
+ * @param count    Set to the number of arguments
+ * @return  False if no frame was waiting, or as for the other decode().
+ */
+bool LumenFrame::decode(WiFiUDP& socket, uint16_t session, int slot,
+    char& command, CommandInterpreter::Argument* argv, int& count) {
+
+  static uint8_t data[TEXT_SIZE];
+  if (socket.parsePacket() <= 0)
+    return false;
+  int length = socket.read(data, sizeof(data));
+
+  uint8_t channels[MAX_CHANNELS];
+  if (!decode(data, length, session, slot, command, channels, count))
+    return false;
+  for (int i = 0; i < count; i++)
+    argv[i].integer = channels[i];
+  return true;
+}
+
+/**
+ * Private
+ * Text form of decode(), reading from text up to end.
+ */
+bool LumenFrame::decodeText(const char* text, const char* end, uint16_t session, int slot,
+    char& command, uint8_t* channels, int& count) {
+
+  long value;
+  if (end - text < 2 || text[0] != 'f' || text[1] != ' ')
+    return false;
+  text = parseDecimal(text + 2, end, 65535, value);
+  if (text == NULL || text >= end || *text != '\n' || value != session)
+    return false;
+  text++;
+
+  //Skip the lines of the slots before ours
+  for (int i = 0; i < slot; i++) {
+    text = (const char*)memchr(text, '\n', end - text);
+    if (text == NULL)
+      return false;
+    text++;
+  }
+
+  if (end - text < 2 || (text[0] != 'c' && text[0] != 't'))
+    return false;
+  command = text[0];
+  text++;
+
+  count = 0;
+  while (text < end && *text == ' ') {
+    if (count >= MAX_CHANNELS)
+      return false;
+    text = parseDecimal(text + 1, end, 255, value);
+    if (text == NULL)
+      return false;
+    channels[count++] = value;
+  }
+  if (text < end && *text != '\n')
+    return false;
+  return count >= (command == 'c' ? 3 : 1) && (command == 'c' || count <= 2);
+}
+
+/**
+ * Private
+ * Reads an unsigned decimal number of at most 5 digits.
+ * 
+ * @return  Where the number ends, NULL if there is none or it exceeds maximum.
+ */
+const char* LumenFrame::parseDecimal(const char* text, const char* end, long maximum, long& out) {
+  long value = 0;
+  int digits = 0;
+  for (; text < end && *text >= '0' && *text <= '9'; text++) {
+    if (++digits > 5)
+      return NULL;
+    value = value * 10 + (*text - '0');
+  }
+  if (digits == 0 || value > maximum)
+    return NULL;
+  out = value;
+  return text;
+}
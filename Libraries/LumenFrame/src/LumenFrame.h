@@ -0,0 +1,63 @@
+/**
+ * The Flying Squirrels: Squirrel Lighting Controller
+ * Purpose: Encode and decode the frames iocontrol broadcasts to the lumens,
+ *          as text or fixed width binary
+ * Date:    2026-10-17
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <WiFiUdp.h>
+#include <CommandInterpreter.h>
+
+class LumenFrame {
+public:
+  static const int MAX_SLOTS = 32;
+  static const int MAX_CHANNELS = 5;
+
+  //First byte of a binary frame, text frames start with 'f'
+  static const uint8_t BINARY_MAGIC = 0xF5;
+  static const int BINARY_HEADER_SIZE = 4;  //Magic, session (2), slot count
+  static const int BINARY_SLOT_SIZE = 1 + MAX_CHANNELS;
+  static const int BINARY_SIZE = BINARY_HEADER_SIZE + MAX_SLOTS * BINARY_SLOT_SIZE;
+
+  //"c 255 255 255 255 255\n" is the longest line
+  static const int TEXT_LINE_SIZE = 2 + MAX_CHANNELS * 4;
+  static const int TEXT_HEADER_SIZE = 8;    //"f 65535\n"
+  static const int TEXT_SIZE = TEXT_HEADER_SIZE + MAX_SLOTS * TEXT_LINE_SIZE;
+
+  LumenFrame(uint16_t = 0);
+  void setSession(uint16_t);
+  uint16_t getSession() { return session; }
+  void setSlotCount(int);
+  int getSlotCount() { return slotCount; }
+  bool set(int, char, const uint8_t*, int);
+  bool isChanged() { return changed; }
+  const char* encodeText(int&);
+  const uint8_t* encodeBinary(int&);
+
+  static int formatDecimal(char*, uint16_t);
+  static bool decode(const uint8_t*, int, uint16_t, int, char&, uint8_t*, int&);
+  static bool decode(WiFiUDP&, uint16_t, int, char&, CommandInterpreter::Argument*, int&);
+
+private:
+  uint16_t session;
+  int slotCount = 0;
+  bool changed = true;
+
+  //Slot state, the binary frame is kept up to date as fields change
+  uint8_t binary[BINARY_SIZE];
+
+  //Text lines are encoded again only when their slot changed
+  char lines[MAX_SLOTS][TEXT_LINE_SIZE];
+  uint8_t lineLengths[MAX_SLOTS];
+  bool lineStale[MAX_SLOTS];
+  char text[TEXT_SIZE];
+  int textLength = 0;
+  bool textStale = true;
+
+  void encodeLine(int);
+  static bool decodeText(const char*, const char*, uint16_t, int, char&, uint8_t*, int&);
+  static const char* parseDecimal(const char*, const char*, long, long&);
+};
@@ -0,0 +1,74 @@
+/**
+ * The Flying Squirrels: Squirrel Lighting Controller
+ * Node:     TEST
+ * Hardware: ESP8266-01[S]
+ * Purpose:  Compare command dispatch lookup cost against a linear scan
+ * Date:     2026-10-17
+ */
+
+#include <CommandInterpreter.h>
+
+const int MAX_COMMANDS = 32;
+const int NAME_LENGTH = 16;
+const int ITERATIONS = 2000;
+
+//Reference copy of the original fixed-width name table and linear search
+char linearNames[MAX_COMMANDS * (NAME_LENGTH + 1)];
+int linearCount = 0;
+
+int linearFind(const char* command) {
+  for (int i = 0; i < linearCount; i++)
+    if (strcmp(command, &linearNames[i * (NAME_LENGTH + 1)]) == 0)
+      return i;
+  return -1;
+}
+
+void commandNothing(Stream& port, int argc, const char** argv) {
+}
+
+/**
+ * Registers the given number of commands in both tables and reports the
+ * average cycles per lookup for the last registered name and for a miss.
+ */
+void runBenchmark(int commandCount) {
+  CommandInterpreter interpreter;
+  linearCount = 0;
+  char name[NAME_LENGTH + 1];
+  
+  for (int i = 0; i < commandCount; i++) {
+    sprintf(name, "command-%02d", i);
+    interpreter.assign(name, commandNothing);
+    strcpy(&linearNames[linearCount++ * (NAME_LENGTH + 1)], name);
+  }
+
+  const char* lookups[] = {name, "not-a-command"};
+  for (int l = 0; l < 2; l++) {
+    volatile int result = 0;
+    
+    uint32_t start = ESP.getCycleCount();
+    for (int i = 0; i < ITERATIONS; i++)
+      result += linearFind(lookups[l]);
+    uint32_t linearCycles = (ESP.getCycleCount() - start) / ITERATIONS;
+    
+    start = ESP.getCycleCount();
+    for (int i = 0; i < ITERATIONS; i++)
+      result += interpreter.indexOf(lookups[l]);
+    uint32_t indexedCycles = (ESP.getCycleCount() - start) / ITERATIONS;
+    
+    Serial.printf("%2d commands, %-5s linear %5u cycles, indexed %5u cycles\n",
+        commandCount, l == 0 ? "hit" : "miss", linearCycles, indexedCycles);
+    yield();
+  }
+}
+
+void setup() {
+  Serial.begin(9600);
+  delay(500);
+  Serial.print("Command dispatch benchmark\n");
+
+  for (int count = 4; count <= MAX_COMMANDS; count *= 2)
+    runBenchmark(count);
+}
+
+void loop() {
+}
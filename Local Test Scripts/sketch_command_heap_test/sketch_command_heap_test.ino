@@ -0,0 +1,213 @@
+/**
+ * The Flying Squirrels: Squirrel Lighting Controller
+ * Node:     TEST
+ * Hardware: ESP8266-01[S]
+ * Purpose:  Count heap allocations made while replying to commands
+ * Date:     2026-10-17
+ */
+
+#include <CommandInterpreter.h>
+#include <WiFiUdp.h>
+
+//The host build (see Host Build) counts every allocation, the device can
+//only sample the free heap
+#ifdef HOST_BUILD
+#include <HostHeap.h>
+#endif
+
+const int COMMAND_COUNT = 500;
+const int DATAGRAM_COUNT = 200;
+const uint16_t NODE_PORT = 5010;
+const uint16_t CLIENT_PORT = 5011;
+
+//One status and enough dumps per datagram that the replies overflow the
+//response buffer (CommandInterpreter::UDP_PACKET_SIZE) and spill
+const char DUMP_LINE[] =
+    "dump 0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef\n";
+const int DUMP_COMMANDS = 15;
+
+/**
+ * Loops a single command line as input and samples the free heap on every
+ * reply byte written. A reply staged on the heap shows up as free heap
+ * below the idle baseline while it is being passed through.
+ */
+class HeapProbeStream : public Stream {
+public:
+  HeapProbeStream(const char* command) : command(command) {}
+  int available() { return remaining; }
+  int read() {
+    if (remaining <= 0)
+      return -1;
+    int value = command[length - remaining];
+    remaining--;
+    return value;
+  }
+  int peek() { return remaining > 0 ? command[length - remaining] : -1; }
+  void flush() {}
+  size_t write(uint8_t u_Data) { return write(&u_Data, 1); }
+  size_t write(const uint8_t* data, size_t size) {
+    uint32_t freeHeap = ESP.getFreeHeap();
+    if (freeHeap < lowestFreeHeap)
+      lowestFreeHeap = freeHeap;
+    return size;
+  }
+  
+  void queueCommand() {
+    length = strlen(command);
+    remaining = length;
+  }
+  uint32_t lowestFreeHeap = 0xFFFFFFFF;
+
+private:
+  const char* command;
+  int length = 0;
+  int remaining = 0;
+};
+
+CommandInterpreter interpreter;
+unsigned long handledCount = 0;
+
+void commandStatus(Stream& reply, int argc, const char** argv) {
+  handledCount++;
+  reply.printf("status %i %i %i\n", 255, 128, 0);
+  reply.print("OK\n");
+  reply.flush();
+}
+
+void commandDump(Stream& reply, int argc, const char** argv) {
+  handledCount++;
+  reply.print(DUMP_LINE);
+  reply.print(DUMP_LINE);
+}
+
+/**
+ * Replies to serial commands through handle().
+ */
+void testStream() {
+  HeapProbeStream probe("status a b c\n");
+
+  //Warm up once so any one-time setup is excluded
+  probe.queueCommand();
+  interpreter.handle(probe);
+  
+  uint32_t allocatingCommands = 0;
+#ifdef HOST_BUILD
+  uint32_t allocations = HostHeap::allocations();
+#endif
+  for (int i = 0; i < COMMAND_COUNT; i++) {
+    uint32_t idleFreeHeap = ESP.getFreeHeap();
+    probe.lowestFreeHeap = idleFreeHeap;
+    probe.queueCommand();
+    interpreter.handle(probe);
+    
+    if (probe.lowestFreeHeap < idleFreeHeap || ESP.getFreeHeap() != idleFreeHeap)
+      allocatingCommands++;
+  }
+  
+  Serial.printf("%i commands, %u allocated heap while replying\n", 
+      COMMAND_COUNT, allocatingCommands);
+#ifdef HOST_BUILD
+  Serial.printf("  %u heap allocations\n", HostHeap::allocations() - allocations);
+#endif
+}
+
+/**
+ * Sends datagrams of several commands over loopback to handleUdp(). The
+ * replies of each datagram overflow the response buffer, so part of them is
+ * sent early (spilled) and each datagram is answered in more than one packet.
+ * Only the handleUdp() calls are counted, not the test client.
+ */
+void testUdp() {
+  IPAddress loopback(127, 0, 0, 1);
+  WiFiUDP nodePort;
+  WiFiUDP clientPort;
+  if (!nodePort.begin(NODE_PORT) || !clientPort.begin(CLIENT_PORT)) {
+    Serial.print("udp: could not bind loopback ports, skipped\n");
+    return;
+  }
+
+  //Build the multi-command datagram
+  static char datagram[sizeof(DUMP_LINE) * (DUMP_COMMANDS + 1)];
+  int length = sprintf(datagram, "status a b c\n");
+  for (int i = 0; i < DUMP_COMMANDS; i++)
+    length += sprintf(&datagram[length], "%s", DUMP_LINE);
+
+  unsigned long datagrams = 0;
+  unsigned long replyPackets = 0;
+  unsigned long replyBytes = 0;
+  uint32_t allocatingDatagrams = 0;
+#ifdef HOST_BUILD
+  uint32_t allocations = 0;
+#endif
+  for (int i = 0; i <= DATAGRAM_COUNT; i++) {
+    clientPort.beginPacket(loopback, NODE_PORT);
+    clientPort.write((const uint8_t*)datagram, length);
+    clientPort.endPacket();
+
+    //Loopback delivery may take a pass of the network stack
+    unsigned long handled = handledCount;
+    uint32_t idleFreeHeap = ESP.getFreeHeap();
+#ifdef HOST_BUILD
+    uint32_t allocationsBefore = HostHeap::allocations();
+#endif
+    for (int wait = 0; handledCount == handled && wait < 100; wait++) {
+      interpreter.handleUdp(nodePort);
+      if (handledCount == handled)
+        delay(1);
+    }
+    if (handledCount == handled)
+      break;
+    bool allocated = ESP.getFreeHeap() != idleFreeHeap;
+#ifdef HOST_BUILD
+    allocated = allocated || HostHeap::allocations() != allocationsBefore;
+#endif
+
+    //The first datagram is a warm up, so any one-time setup is excluded
+    if (i > 0) {
+      datagrams++;
+      if (allocated)
+        allocatingDatagrams++;
+#ifdef HOST_BUILD
+      allocations += HostHeap::allocations() - allocationsBefore;
+#endif
+    }
+
+    //Collect the replies
+    delay(1);
+    int size;
+    while ((size = clientPort.parsePacket()) > 0) {
+      if (i > 0) {
+        replyPackets++;
+        replyBytes += size;
+      }
+      clientPort.flush();
+    }
+  }
+
+  if (datagrams == 0) {
+    Serial.print("udp: no datagrams came back over loopback, skipped\n");
+    return;
+  }
+  Serial.printf("%lu datagrams of %i commands, %lu reply packets (%lu bytes)\n",
+      datagrams, DUMP_COMMANDS + 1, replyPackets, replyBytes);
+  Serial.printf("  %u allocated heap while replying\n", allocatingDatagrams);
+#ifdef HOST_BUILD
+  Serial.printf("  %u heap allocations\n", allocations);
+#endif
+}
+
+void setup() {
+  Serial.begin(9600);
+  delay(500);
+  Serial.print("Command heap test\n");
+  
+  interpreter.assign("status", commandStatus);
+  interpreter.assign("dump", commandDump);
+  interpreter.enableSequenceNumbers(true);
+
+  testStream();
+  testUdp();
+}
+
+void loop() {
+}
@@ -0,0 +1,156 @@
+/**
+ * The Flying Squirrels: Squirrel Lighting Controller
+ * Node:     TEST
+ * Hardware: ESP8266-01[S]
+ * Purpose:  Compare bulk command parsing against the byte at a time loop
+ * Date:     2026-10-17
+ */
+
+#include <CommandInterpreter.h>
+
+const int PACKET_SIZE = 512;
+const int LINE_COUNT = 4000;
+const int BUFFER_SIZE = 255;
+
+/**
+ * Serves a block of command text in packets, checking for the next packet
+ * on every call like UdpStream does. Supports bulk reads.
+ */
+class PacketStream : public Stream {
+public:
+  PacketStream(const char* data, int length) : data(data), length(length) {}
+  int available() { nextPacket(); return packetEnd - position; }
+  int read() { nextPacket(); return position < packetEnd ? data[position++] : -1; }
+  int peek() { nextPacket(); return position < packetEnd ? data[position] : -1; }
+  void flush() {}
+  size_t write(uint8_t u_Data) { return 1; }
+  size_t readBytes(char* buffer, size_t size) {
+    nextPacket();
+    size_t count = packetEnd - position;
+    count = size < count ? size : count;
+    memcpy(buffer, &data[position], count);
+    position += count;
+    return count;
+  }
+  void rewind() { position = 0; packetEnd = 0; }
+  bool done() { return position >= length; }
+
+private:
+  void nextPacket() {
+    if (position >= packetEnd && position < length)
+      packetEnd = position + PACKET_SIZE < length ? position + PACKET_SIZE : length;
+  }
+  const char* data;
+  int length;
+  int position = 0;
+  int packetEnd = 0;
+};
+
+//Reference copy of the byte at a time receive loop
+char referenceBuffer[BUFFER_SIZE + 1];
+int referencePointer = 0;
+int referenceLines = 0;
+
+void referenceHandle(Stream& port) {
+  while (port.available() > 0) {
+    if (referencePointer >= BUFFER_SIZE) {
+      referencePointer = 0;
+      return;
+    }
+    char received = port.read();
+    if (received == '\r')
+      continue;
+    referenceBuffer[referencePointer] = received;
+    referenceBuffer[++referencePointer] = '\0';
+    if (received == '\n') {
+      referenceBuffer[referencePointer - 1] = '\0';
+      referencePointer = 0;
+      referenceLines++;
+    }
+  }
+}
+
+int interpreterLines = 0;
+void commandCount(Stream& port, int argc, const char** argv) {
+  interpreterLines++;
+}
+
+unsigned long bytesPerSecond(int length, uint32_t elapsedMicros) {
+  return (unsigned long)((uint64_t)length * 1000000 / (elapsedMicros ? elapsedMicros : 1));
+}
+
+/**
+ * Parses the same block of commands with both loops and reports bytes/sec.
+ */
+void runBenchmark(const char* name, const char** lines, int lineKinds) {
+  
+  //Build a block of commands from the given lines
+  int length = 0;
+  for (int i = 0; i < LINE_COUNT; i++)
+    length += strlen(lines[i % lineKinds]);
+  char* text = (char*)malloc(length + 1);
+  char* end = text;
+  for (int i = 0; i < LINE_COUNT; i++)
+    end += sprintf(end, "%s", lines[i % lineKinds]);
+  PacketStream stream(text, length);
+
+  referenceLines = 0;
+  uint32_t start = micros();
+  while (!stream.done()) {
+    referenceHandle(stream);
+    yield();
+  }
+  uint32_t referenceMicros = micros() - start;
+
+  //Without commands assigned, the interpreter parses lines and drops them
+  //at lookup. The last call executes whatever is still queued.
+  CommandInterpreter parser;
+  parser.setBudget(8);
+  stream.rewind();
+  start = micros();
+  while (!stream.done()) {
+    parser.handle(stream);
+    yield();
+  }
+  parser.handle(stream);
+  uint32_t bulkMicros = micros() - start;
+
+  CommandInterpreter interpreter;
+  interpreter.assign("c", commandCount);
+  interpreter.assign("t", commandCount);
+  interpreter.assign("debug", commandCount);
+  interpreter.setBudget(8);
+  interpreterLines = 0;
+  stream.rewind();
+  start = micros();
+  while (!stream.done() || interpreterLines < referenceLines) {
+    interpreter.handle(stream);
+    yield();
+  }
+  uint32_t dispatchMicros = micros() - start;
+
+  Serial.printf("%s: %i bytes, %i lines\n", name, length, referenceLines);
+  Serial.printf("  byte loop: %10lu bytes/sec (parse only)\n", bytesPerSecond(length, referenceMicros));
+  Serial.printf("  bulk read: %10lu bytes/sec (parse only)\n", bytesPerSecond(length, bulkMicros));
+  Serial.printf("  bulk read: %10lu bytes/sec (parse and dispatch)\n", bytesPerSecond(length, dispatchMicros));
+  free(text);
+}
+
+void setup() {
+  Serial.begin(9600);
+  delay(500);
+  Serial.print("Command parse benchmark\n");
+
+  const char* SHORT_LINES[] = {"c 255 128 0 64\r\n", "t 200 180\n", "c 12 34 56 78 90\n", "t 255\r\n"};
+  runBenchmark("Color commands", SHORT_LINES, 4);
+  
+  const char* LONG_LINES[] = {
+    "debug lumen-1 reported a frame drop while the io controller was sending at thirty two "
+        "milliseconds per frame with a queue depth of four and retries disabled\n",
+    "debug lumen-2 reconnected to the squirrel after a beacon timeout\r\n"
+  };
+  runBenchmark("Debug text", LONG_LINES, 2);
+}
+
+void loop() {
+}
@@ -0,0 +1,55 @@
+#ifndef _SAMPLE_RING_CPP_
+#define _SAMPLE_RING_CPP_
+
+#include "SampleRing.h"
+
+/**
+ * Adds a sample, from the producer side only.
+ *
+ * @return  False if the ring was full and the sample was dropped.
+ */
+template <typename T, uint8_t SIZE>
+bool SampleRing<T, SIZE>::push(uint32_t time, const T& value) {
+  uint8_t at = head;
+  if ((uint8_t)(at - tail) >= SIZE) {
+    dropped++;
+    return false;
+  }
+  buffer[at & (SIZE - 1)].time = time;
+  buffer[at & (SIZE - 1)].value = value;
+  //Publish the sample only once it is written (single core, so keeping the
+  //compiler from reordering the stores is enough)
+  __asm__ __volatile__("" ::: "memory");
+  head = at + 1;
+  return true;
+}
+
+/**
+ * Takes the oldest sample, from the consumer side only.
+ *
+ * @return  False if the ring was empty.
+ */
+template <typename T, uint8_t SIZE>
+bool SampleRing<T, SIZE>::pop(Sample& out) {
+  uint8_t at = tail;
+  if (at == head)
+    return false;
+  out.time = buffer[at & (SIZE - 1)].time;
+  out.value = buffer[at & (SIZE - 1)].value;
+  //Free the slot only once it is read
+  __asm__ __volatile__("" ::: "memory");
+  tail = at + 1;
+  return true;
+}
+
+template <typename T, uint8_t SIZE>
+uint8_t SampleRing<T, SIZE>::available() {
+  return head - tail;
+}
+
+template <typename T, uint8_t SIZE>
+unsigned long SampleRing<T, SIZE>::getDroppedCount() {
+  return dropped;
+}
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef _SAMPLE_RING_H_
+#define _SAMPLE_RING_H_
+
+#include <Arduino.h>
+
+/**
+ * Fixed size queue of timestamped samples, for one producer and one consumer.
+ * The producer only moves the head and the consumer only moves the tail, so
+ * neither needs a lock, and the producer may run from an interrupt. SIZE must
+ * be a power of two, up to 128. When full, new samples are dropped and counted.
+ */
+template <typename T, uint8_t SIZE>
+class SampleRing {
+public:
+  static_assert(SIZE > 0 && SIZE <= 128 && (SIZE & (SIZE - 1)) == 0,
+                "SampleRing size must be a power of two up to 128");
+
+  struct Sample {
+    uint32_t time;
+    T value;
+  };
+
+  bool push(uint32_t time, const T& value);
+  bool pop(Sample& out);
+  uint8_t available();
+  unsigned long getDroppedCount();
+
+private:
+  Sample buffer[SIZE];
+  volatile uint8_t head = 0; //Next slot to fill, written by the producer only
+  volatile uint8_t tail = 0; //Next slot to take, written by the consumer only
+  volatile unsigned long dropped = 0;
+};
+
+#include "SampleRing.cpp"
+
+#endif
@@ -24,10 +24,13 @@
 #include <ESP8266Ping.h>
 
 #include <TcpClientRegistrar.h>
+#include <NameResolver.h>
 #include <CommandInterpreter.h>
 #include <Pcf8591.h>
 #include <UdpStream.h>
+#include <LumenFrame.h>
 #include "AverageTracker.h"
+#include "SampleRing.h"
 
 Pcf8591 ioChip(&Wire);
 
@@ -36,13 +39,33 @@ UdpStream outboundClientPressure;
 UdpStream inboundSquirrel;
 UdpStream outboundSquirrel;
 
+//Slave addresses looked up through the squirrel, which pushes changes
+NameResolver slaveNames(outboundSquirrel);
+
 const int PORT_SQUIRREL_TO_IO = 200;
 const int PORT_IO_TO_SQUIRREL = 201;
 const int PORT_IO_TO_DAYLIGHT = 300;
 const int PORT_IO_TO_PRESSURE = 400;
+const int PORT_LUMEN_DATA = 23;
+const int PORT_LUMEN_FRAME = 26;
+//How long a sensor poll of the daylight and pressure nodes may go unanswered,
+//in mS, and how many polls in a row before the node is dropped
+const uint32_t SLAVE_REPLY_TIMEOUT = 250;
+const int SLAVE_MAX_MISSED = 3;
+//A reading older than this (mS) is stale
+const uint32_t SENSOR_STALE_TIME = 1000;
+//The sensor nodes push readings sampled every SUBSCRIBE_RATE mS that change
+//by more than SUBSCRIBE_DELTA, and at least every SUBSCRIBE_HEARTBEAT mS. The
+//subscription is renewed well within the nodes' 10 S lease.
+const int SUBSCRIBE_RATE = 20;
+const int SUBSCRIBE_DELTA = 2;
+const uint32_t SUBSCRIBE_HEARTBEAT = 500;
+const uint32_t SUBSCRIBE_RENEW = 5000;
 
 WiFiUDP clientDiscover;
 WiFiUDP dataBroadcast;
+WiFiUDP announceSocket;
+TcpClientRegistrar::Announcement announcement;
 
 //Wireless nonsense
 const char* WIFI_SSID = "SQUIRREL_NET";
@@ -85,9 +108,37 @@ uint8_t motionValue = 0;
 //Photosensor
 uint8_t photoLevel = 0;
 
+//Sensor subscriptions are sent together, and the readings picked up on later
+//passes of the loop, so a slow or missing node never holds up the frames
+struct SensorPoll {
+  UdpStream* stream;
+  const char* name;
+  uint8_t* value;
+  bool waiting;
+  uint32_t sentTime;
+  uint32_t updateTime;     //millis() of the last reading, 0 if none yet
+  int missed;              //Polls unanswered in a row
+  unsigned long timeouts;  //Polls unanswered in all
+  char reply[8];
+  uint8_t replyLength;
+};
+SensorPoll pressurePoll = {&outboundClientPressure, "pressure", &pressureLevel};
+SensorPoll daylightPoll = {&outboundClientDaylight, "daylight", &photoLevel};
+
+//The audio and motion inputs are sampled every ADC_SAMPLE_PERIOD uS on a
+//fixed schedule, whatever else the loop is doing, and handled in batches
+const uint32_t ADC_SAMPLE_PERIOD = 2000;
+struct AdcSample {
+  uint8_t audio;
+  uint8_t motion;
+};
+SampleRing<AdcSample, 64> adcSamples;
+uint32_t nextSampleTime = 0;
+unsigned long samplesMissed = 0; //Schedule slots passed while the loop was busy
+
 //Audio Sensor
 uint8_t audioLevel = 0;
-static AverageTracker<uint8_t> avg(14);
+static AverageTracker<uint8_t> avg(70000 / ADC_SAMPLE_PERIOD); //About 70 mS
 uint8_t listenRed = 0;
 uint8_t listenGreen = 0;
 uint8_t listenBlue = 0;
@@ -109,9 +160,25 @@ enum PowerChangeState {POWER_ON, POWER_OFF, POWER_TOGGLE};
 
 CommandInterpreter squirrelCmd;
 
-//Store discovered bulb IPs as they send discovery packets
-const int MAX_LUMEN_NODES = 16;
+//Store discovered bulb IPs as they send discovery packets, the index is the
+//bulb's slot in frames. Bulbs sending "db" can read binary frames.
+const int MAX_LUMEN_NODES = LumenFrame::MAX_SLOTS;
 IPAddress lumenNodes[MAX_LUMEN_NODES];
+bool lumenBinary[MAX_LUMEN_NODES];
+
+//Frames name a session, so bulbs holding slots from before a restart ignore
+//them until they discover again and get their slot anew
+LumenFrame frame;
+
+//Frames go to the bulbs only when the output changes, and are repeated once a
+//second so a bulb that lost one catches up (and keeps hearing from us, see the
+//lumen discovery timeouts)
+const uint32_t FRAME_INTERVAL = 32;
+const uint32_t KEYFRAME_INTERVAL = 1000;
+bool frameForced = true;
+uint32_t lastFrameTime = 0;
+unsigned long framesSent = 0;
+unsigned long framesSkipped = 0;
 
 WiFiEventHandler disconnectedEventHandler;
 
@@ -123,6 +190,8 @@ void setup() {
   delay(500);
   Serial.print("Initialized\n");
   Wire.begin(2, 0);
+  //Squirrel streams commands here, acknowledged and retransmitted on loss
+  inboundSquirrel.enableReliable(true);
   inboundSquirrel.begin(PORT_SQUIRREL_TO_IO);
 
   //Set up the wireless
@@ -147,6 +216,10 @@ void setup() {
   squirrelCmd.assign("listen", onCommandSetListen);
   squirrelCmd.assign("get-debug", onCommandGetDebug);
   squirrelCmd.assign("drop-remote", onCommandDropRemote);
+  squirrelCmd.assign("ip-changed", onCommandIpChanged);
+
+  frame.setSession(random(0, 65536));
+  nextSampleTime = micros();
 }
 
 /**
@@ -159,19 +232,29 @@ void loop() {
   //Do nothing until we are connected to the server
   handleReconnect();
 
+  sampleAdc();
+
   //Handle commands
   squirrelCmd.handle(Serial);
   squirrelCmd.handle(inboundSquirrel);
+  sampleAdc();
   
-  //Catch any discovery packets from lumen nodes ("d")
-  char discBuffer;
+  //Catch any discovery packets from lumen nodes ("d", or "db" for binary
+  //frames), optionally followed by the port the node takes commands on
+  char discBuffer[10];
   int packetSize = clientDiscover.parsePacket();
   if (packetSize) {
-    discBuffer = 0;
     IPAddress newClientIP = clientDiscover.remoteIP();
     
-    clientDiscover.read(&discBuffer, 1);
-    if (discBuffer == 'd') {
+    int discLength = clientDiscover.read(discBuffer, sizeof(discBuffer) - 1);
+    discBuffer[discLength > 0 ? discLength : 0] = '\0';
+    if (discLength > 0 && discBuffer[discLength - 1] == '\n')
+      discBuffer[discLength - 1] = '\0';
+
+    long discPort = PORT_LUMEN_DATA;
+    char* discPortText = strchr(discBuffer, ' ');
+    if (discBuffer[0] == 'd' && (discPortText == NULL
+        || CommandInterpreter::parseInteger(discPortText + 1, 1, 65535, discPort))) {
 
       int i = 0;
       for (; i < MAX_LUMEN_NODES && lumenNodes[i] != 0 && lumenNodes[i] != newClientIP; i++);
@@ -182,11 +265,24 @@ void loop() {
         Serial.print(newClientIP);
         Serial.print('\n');
         lumenNodes[i] = newClientIP;
+        frame.setSlotCount(i + 1);
+      }
+
+      //A bulb only discovers while it is not hearing frames, tell it its slot
+      //and bring it up to date right away
+      if (i < MAX_LUMEN_NODES) {
+        dataBroadcast.beginPacket(newClientIP, discPort);
+        dataBroadcast.printf("slot %i %u\n", i, frame.getSession());
+        dataBroadcast.endPacket();
+        lumenBinary[i] = discBuffer[1] == 'b';
+        frameForced = true;
       }
     }
   }
   
-  if (collectSensorData(false)) {
+  collectSensorData();
+  sampleAdc();
+  if (adcSamples.available() > 0) {
     updateAudioMotionPowerOnOffColorFlip();
   }
 
@@ -196,33 +292,33 @@ void loop() {
 
   // Changes outputs in a given time span
   thisSendTime = millis();
-  if (thisSendTime - lastSendTime > 32) {
+  if (thisSendTime - lastSendTime > FRAME_INTERVAL) {
     lastSendTime = thisSendTime;
     
     //Construct command
-    char toSend[32];
+    char command = 'c';
+    uint8_t channels[3];
+    int count = 3;
 
     //Output colors
     if (outputMode == MODE_COLOR) {
       if (colorAuto) {
         hsvToRgb((millis() / 30) % 255, 255, valueWithBrightness(255),
-                                  listenRed, listenGreen, listenBlue);
-        
-        sprintf(toSend, "c %i %i %i\n", listenRed, listenGreen, listenBlue);
+                                  channels[0], channels[1], channels[2]);
       }
       else {
-        sprintf(toSend, "c %i %i %i\n", valueWithBrightness(colorRed),
-                                        valueWithBrightness(colorGreen), 
-                                        valueWithBrightness(colorBlue));
+        channels[0] = valueWithBrightness(colorRed);
+        channels[1] = valueWithBrightness(colorGreen);
+        channels[2] = valueWithBrightness(colorBlue);
       }
     }
 
     //Output color temperature
     else if (outputMode == MODE_TEMP) {
-      if (tempAuto)
-        sprintf(toSend, "t %i %i\n", photoLevel, valueWithBrightness(255));
-      else
-        sprintf(toSend, "t %i %i\n", temperature, valueWithBrightness(255));
+      command = 't';
+      count = 2;
+      channels[0] = tempAuto ? photoLevel : temperature;
+      channels[1] = valueWithBrightness(255);
     }
     
     //Output audio reaction
@@ -251,24 +347,53 @@ void loop() {
       }
       
       hsvToRgb(listenHue, 255, (uint8_t)pulseBrightness, listenRed, listenGreen, listenBlue);
-      sprintf(toSend, "c %i %i %i\n", listenRed, listenGreen, listenBlue);
+      channels[0] = listenRed;
+      channels[1] = listenGreen;
+      channels[2] = listenBlue;
     }
 
     //Bulb is off, output black
     else if (outputMode == MODE_OFF) {
-      sprintf(toSend, "c 0 0 0\n");
+      channels[0] = 0;
+      channels[1] = 0;
+      channels[2] = 0;
     }
 
-    if (outputMode != MODE_YIELD) {
-      //Send the UDP update to each discovered node
-      for (int i = 0; i < MAX_LUMEN_NODES && lumenNodes[i] != 0; i++) {
-        dataBroadcast.beginPacket(lumenNodes[i], 23);
-        dataBroadcast.write(toSend);
-        dataBroadcast.endPacket();
+    if (outputMode == MODE_YIELD) {
+      //Whoever had the bulbs may have changed them, resend when we take over
+      frameForced = true;
+    }
+    else {
+      //Only slots whose values changed are encoded again
+      bool binary = true;
+      for (int i = 0; i < frame.getSlotCount(); i++) {
+        frame.set(i, command, channels, count);
+        binary = binary && lumenBinary[i];
+      }
+
+      if (frameForced || frame.isChanged() || thisSendTime - lastFrameTime >= KEYFRAME_INTERVAL) {
+        //One broadcast frame carries every discovered node's slot, so all the
+        //bulbs change at once. Binary only if every bulb can read it.
+        if (frame.getSlotCount() > 0) {
+          int length;
+          dataBroadcast.beginPacket(IPAddress(192, 168, 3, 255), PORT_LUMEN_FRAME);
+          if (binary)
+            dataBroadcast.write(frame.encodeBinary(length), length);
+          else
+            dataBroadcast.write((const uint8_t*)frame.encodeText(length), length);
+          dataBroadcast.endPacket();
+        }
+        frameForced = false;
+        lastFrameTime = thisSendTime;
+        framesSent++;
+      }
+      else {
+        framesSkipped++;
       }
     }
   }
   
+  sampleAdc();
   handleHeartbeat();
 }
 
@@ -341,10 +466,22 @@ void triggerReconnect(const WiFiEventStationModeDisconnected& event) {
  * 3. Open any other dependent connections
  */
 void handleReconnect() {
-  //Reconnect if server TCP connection lost
-  if (!outboundSquirrel.connected())
+  //Reconnect if server connection lost, a sync or announcement still in
+  //progress is left alone
+  if (needsBegin(outboundSquirrel)
+      && announcement.getState() != TcpClientRegistrar::Announcement::ANNOUNCING)
     reconnect = true;
   
+  //Registration goes on while the loop runs. A squirrel that does not answer
+  //announcements registers us with a TCP handshake instead.
+  if (announcement.poll() == TcpClientRegistrar::Announcement::TIMED_OUT) {
+    announcement.reset();
+    WiFiClient tempClient;
+    if (!TcpClientRegistrar::connectClient(
+          tempClient, IPAddress(192, 168, 3, 1), 23, "iocontrol", false))
+      reconnect = true;
+  }
+  
   while (reconnect) {
     //Clean up all connections
     clientDiscover.stop();
@@ -364,20 +501,23 @@ void handleReconnect() {
     //Open port for lumen broadcast discovery
     clientDiscover.begin(23);
     
-    WiFiClient tempClient;
-    if (TcpClientRegistrar::connectClient(
-	        tempClient, IPAddress(192, 168, 3, 1), 23, "iocontrol", false))
-      reconnect = false;
+    //Changes pushed while we were away are lost, ask again
+    slaveNames.invalidateAll();
+    
+    //Announce to squirrel with one datagram
+    announceSocket.begin(TcpClientRegistrar::ANNOUNCE_PORT);
+    announcement.begin(announceSocket, IPAddress(192, 168, 3, 255), "iocontrol", PORT_SQUIRREL_TO_IO);
+    reconnect = false;
   }
   
   static int squirrelReconnectTimeout = 0;
-  if (!outboundSquirrel.connected() && millis() - squirrelReconnectTimeout > 2000) {
+  if (needsBegin(outboundSquirrel) && millis() - squirrelReconnectTimeout > 2000) {
     squirrelReconnectTimeout = millis();
     Serial.print("Attempting connect to Squirrel\n");
     
-    //Try to connect persistently to squirrel
+    //Try to connect persistently to squirrel, the sync completes while polling
     if (outboundSquirrel.begin(IPAddress(192, 168, 3, 1), PORT_IO_TO_SQUIRREL)) {
-      Serial.print("Successfully connected to Squirrel\n");
+      Serial.print("Syncing with Squirrel\n");
     }
   }
   
@@ -389,133 +529,221 @@ void handleReconnect() {
 }
 
 /**
- * 
+ * @return  True if the stream is neither connected nor syncing.
+ */
+bool needsBegin(UdpStream& stream) {
+  UdpStream::ConnectState state = stream.getState();
+  return state == UdpStream::STOPPED || state == UdpStream::FAILED;
+}
+
+/**
+ * Looks up a slave through the squirrel and starts syncing with it. The sync
+ * finishes (or fails) in the background, so a missing slave never holds up
+ * the loop.
  */
 void connectToSlave(UdpStream& client, const char* slaveName, uint32_t& lastTime, int port) {
   client.setTimeout(500);
   uint32_t currentTime = millis();
-  if (currentTime - lastTime > 3000 && !reconnect && !client.connected()) {
+  if (currentTime - lastTime > 3000 && !reconnect && outboundSquirrel.connected() && needsBegin(client)) {
     lastTime = currentTime;
     
     Serial.print("DEBUG: Attempting connect to ");
     Serial.print(slaveName);
-    IPAddress ip;
     
-    outboundSquirrel.printf("ip %s\n", slaveName);
-    outboundSquirrel.flush();
-    
-    String strIp = outboundSquirrel.readStringUntil('\n');
-    Serial.print(" Read Ip [ ");
-    Serial.print(strIp);
-    Serial.print("]");
-    ip.fromString(strIp);
+    //A slave that never answered may have moved, look it up again
+    if (client.getState() == UdpStream::FAILED)
+      slaveNames.invalidate(slaveName);
+    IPAddress ip = slaveNames.resolve(slaveName);
     Serial.print(" at IP ");
     Serial.print(ip.toString());
     
     if (ip != IPAddress(0,0,0,0) && client.begin(ip, port))
-        Serial.println(" succeeded.");
+        Serial.println(" syncing.");
     else
       Serial.println(" failed.");
   }
-  client.setTimeout(1000);
 }
 
-bool collectSensorData(bool forceUpdate) {
-  static uint32_t pressureLightSampleTime = millis(), adcSampleTime = millis(), currentTime;
-  currentTime = millis();
-  bool readData = false;
-  
-  if (forceUpdate || currentTime - adcSampleTime > 5) {
-    // Collect data from input pins
-    uint32_t pinValues = ioChip.readAll(PCF_CHIP_SELECT);
-    uint8_t* pin = reinterpret_cast<uint8_t*>(&pinValues);
-    audioLevel = pin[PCF_PIN_AUDIO];
-    motionValue = pin[PCF_PIN_MOTION];
-    
-    readData = true;
-    adcSampleTime = millis();
+/**
+ * Reads the audio and motion inputs into adcSamples when the next slot of the
+ * sampling schedule is due. The I2C read blocks, so this runs from a few
+ * places in the loop rather than from a timer interrupt. A slot missed while
+ * the loop was busy is skipped rather than caught up, so every sample keeps
+ * its real time.
+ */
+void sampleAdc() {
+  uint32_t now = micros();
+  if ((int32_t)(now - nextSampleTime) < 0)
+    return;
+
+  uint32_t pinValues = ioChip.readAll(PCF_CHIP_SELECT);
+  uint8_t* pin = reinterpret_cast<uint8_t*>(&pinValues);
+  AdcSample sample = {pin[PCF_PIN_AUDIO], pin[PCF_PIN_MOTION]};
+  adcSamples.push(now, sample);
+
+  nextSampleTime += ADC_SAMPLE_PERIOD;
+  if ((int32_t)(now - nextSampleTime) >= 0) {
+    uint32_t behind = now - nextSampleTime;
+    samplesMissed += behind / ADC_SAMPLE_PERIOD + 1;
+    nextSampleTime += (behind / ADC_SAMPLE_PERIOD + 1) * ADC_SAMPLE_PERIOD;
   }
+}
+
+/**
+ * Keeps the readings of the daylight and pressure nodes coming in.
+ */
+void collectSensorData() {
+  static uint32_t pressureLightSampleTime = millis(), currentTime;
+  currentTime = millis();
   
-  if (forceUpdate || currentTime - pressureLightSampleTime > 100) {
-    uint8_t tempNum;
-    String tempStr;
-    
-    // Collect pressure sensor data
-    if (outboundClientPressure.connected()) {
-      outboundClientPressure.print("g\n");
-      outboundClientPressure.flush();
-      tempStr = outboundClientPressure.readStringUntil('\n');
-      if (convertNumber(tempStr.c_str(), tempNum)) {
-        pressureLevel = tempNum;
+  //Pick up any replies that arrived since the last pass
+  collectReply(pressurePoll);
+  collectReply(daylightPoll);
+
+  if (currentTime - pressureLightSampleTime > 100) {
+    //Ask both sensor nodes at once
+    sendPoll(pressurePoll);
+    sendPoll(daylightPoll);
+
+    pressureLightSampleTime = millis();
+  }
+
+  //Without fresh readings, don't keep the lights dimmed
+  if (isStale(pressurePoll))
+    pressureLevel = 255;
+}
+
+/**
+ * Subscribes to a sensor node's readings, which it answers with the current
+ * reading. Once readings are pushed, this only renews the subscription now
+ * and then, or when the node has gone quiet (it may have restarted).
+ */
+void sendPoll(SensorPoll& poll) {
+  if (poll.waiting || !poll.stream->connected())
+    return;
+
+  uint32_t now = millis();
+  if (now - poll.updateTime < SUBSCRIBE_HEARTBEAT + SLAVE_REPLY_TIMEOUT
+      && now - poll.sentTime < SUBSCRIBE_RENEW)
+    return;
+
+  poll.stream->printf("subscribe %i %i\n", SUBSCRIBE_RATE, SUBSCRIBE_DELTA);
+  poll.stream->flush();
+  poll.waiting = true;
+  poll.sentTime = millis();
+}
+
+/**
+ * Takes in whatever the sensor node has sent so far, without waiting. Every
+ * complete line is a reading, pushed or in reply to the subscription. A node
+ * that leaves SLAVE_MAX_MISSED subscriptions in a row unanswered is dropped,
+ * to sync again in the background.
+ */
+void collectReply(SensorPoll& poll) {
+  UdpStream& stream = *poll.stream;
+  if (!stream.connected()) {
+    poll.waiting = false;
+    poll.replyLength = 0;
+    return;
+  }
+
+  while (stream.available() > 0) {
+    int c = stream.read();
+    if (c == '\n') {
+      uint8_t reading;
+      poll.reply[poll.replyLength] = '\0';
+      if (convertNumber(poll.reply, reading)) {
+        *poll.value = reading;
+        poll.updateTime = millis();
+        poll.missed = 0;
       }
+      poll.waiting = false;
+      poll.replyLength = 0;
     }
-    
-    // Collect photosensor data
-    if (outboundClientDaylight.connected()) {
-      outboundClientDaylight.print("g\n");
-      outboundClientDaylight.flush();
-      tempStr = outboundClientDaylight.readStringUntil('\n');
-      if (convertNumber(tempStr.c_str(), tempNum)) {
-        photoLevel = tempNum;
-      }
+    else if (c >= 0 && poll.replyLength < sizeof(poll.reply) - 1) {
+      poll.reply[poll.replyLength++] = (char)c;
+    }
+  }
+
+  if (poll.waiting && millis() - poll.sentTime > SLAVE_REPLY_TIMEOUT) {
+    poll.waiting = false;
+    poll.replyLength = 0;
+    poll.timeouts++;
+    if (++poll.missed >= SLAVE_MAX_MISSED) {
+      poll.missed = 0;
+      stream.stop();
+      slaveNames.invalidate(poll.name);
     }
-    
-    readData = true;
-    pressureLightSampleTime = millis();
   }
-  
-  return readData;
 }
 
 /**
- * 
+ * @return  True if the sensor has not given a reading for SENSOR_STALE_TIME.
+ */
+bool isStale(SensorPoll& poll) {
+  return poll.updateTime == 0 || millis() - poll.updateTime > SENSOR_STALE_TIME;
+}
+
+/**
+ * Runs clap and beat detection over the samples taken since the last call, in
+ * the order and at the times they were taken, then checks for motion.
  */
 void updateAudioMotionPowerOnOffColorFlip() {
   static uint8_t lastAudioLevel = 0, lastMaxLevel = 0;
-  static unsigned long lastClapThreshHoldTime = 0;
-  
-  avg.add(audioLevel);
+  static uint32_t lastClapThreshHoldTime = 0;
+  static bool clapPending = false;
   
-  //Figure out if a clap has happened
-  if (clapEnabled || outputMode == MODE_LISTEN) {
-
-    if (audioLevel <= lastAudioLevel) {
-      
-        if (outputMode == MODE_LISTEN) {
-          if (!peakHappened && lastMaxLevel > avg.average() + CLAP_THRESHHOLD) {
-            //Change Color Values
-            listenHue = random(0, 255);
-            lastMaxLevel = -1;
+  bool motionSeen = false;
+  SampleRing<AdcSample, 64>::Sample sample;
+  while (adcSamples.pop(sample)) {
+    audioLevel = sample.value.audio;
+    motionValue = sample.value.motion;
+    motionSeen = motionSeen || motionValue > MOTION_THRESHHOLD;
+    avg.add(audioLevel);
+    
+    //Figure out if a clap has happened
+    if (clapEnabled || outputMode == MODE_LISTEN) {
 
-            peakHappened = true;
-          }
-        } else {
-          
-          if (lastMaxLevel > avg.average() + CLAP_THRESHHOLD) {
-              if (millis() - lastClapThreshHoldTime < 500) {
-                lastClapThreshHoldTime = 0;
-                OnDoubleClap();
-              } else {
-                lastClapThreshHoldTime = millis();
-              }
-            lastMaxLevel = -1;
+      if (audioLevel <= lastAudioLevel) {
+        
+          if (outputMode == MODE_LISTEN) {
+            if (!peakHappened && lastMaxLevel > avg.average() + CLAP_THRESHHOLD) {
+              //Change Color Values
+              listenHue = random(0, 255);
+              lastMaxLevel = -1;
+
+              peakHappened = true;
+            }
+          } else {
+            
+            if (lastMaxLevel > avg.average() + CLAP_THRESHHOLD) {
+                //Clap times are sample times (uS), so loop delays don't count
+                if (clapPending && sample.time - lastClapThreshHoldTime < 500000) {
+                  clapPending = false;
+                  OnDoubleClap();
+                } else {
+                  clapPending = true;
+                  lastClapThreshHoldTime = sample.time;
+                }
+              lastMaxLevel = -1;
+            }
+            
           }
-          
-        }
-      
-      
-      lastMaxLevel = 0;
-    } else {
-      lastMaxLevel = audioLevel;
+        
+        
+        lastMaxLevel = 0;
+      } else {
+        lastMaxLevel = audioLevel;
+      }
     }
+    
+    // Update old audio value
+    lastAudioLevel = audioLevel;
   }
   
-  // Update old audio value
-  lastAudioLevel = audioLevel;
-  
   // Collect motion sensor data
   if (motionEnabled) {
-    if (motionValue > MOTION_THRESHHOLD) {
+    if (motionSeen) {
       // Motion detected
       if (outputMode == MODE_OFF) {
         setPower(POWER_ON);
@@ -550,10 +778,11 @@ uint8_t valueWithBrightness(uint8_t val) {
  *          intirety of the supplied value is a valid integer.
  */
 bool convertNumber(const char* strNum, uint8_t& numOut) {
-  char* numEnd;
-  long int num = strtol( strNum, &numEnd, 10 );
+  long num;
+  if (!CommandInterpreter::parseInteger(strNum, 0, 255, num))
+    return false;
   numOut = static_cast<uint8_t>(num);
-  return ( *strNum != 0 && num == numOut && numEnd != 0 && *numEnd == '\0');
+  return true;
 }
 
 /**
@@ -886,14 +1115,16 @@ void onCommandGetMode(Stream& reply, int argc, const char** argv) {
 }
 
 /**
- * Returns the data from all of the connected sensors in one big block.
+ * Returns the data from all of the connected sensors in one big block. Sensor
+ * readings are the last ones collected, with their age.
  */
 void onCommandGetDebug(Stream& reply, int argc, const char** argv) {
-  collectSensorData(true);
   String strPressure(pressureLevel < PRESSURE_THRESHHOLD ? "PRESSED" : "RELEASED");
   strPressure += " {"; 
   strPressure += pressureLevel;
   strPressure += "}";
+  if (isStale(pressurePoll))
+    strPressure += " stale";
   
   String strPhotoVal;
   switch (photoLevel / 86) {
@@ -907,6 +1138,8 @@ void onCommandGetDebug(Stream& reply, int argc, const char** argv) {
   strPhotoVal += " {"; 
   strPhotoVal += photoLevel;
   strPhotoVal += "}";
+  if (isStale(daylightPoll))
+    strPhotoVal += " stale";
   
   String strAudio;
   int audioDiff = audioLevel - avg.average();
@@ -930,10 +1163,28 @@ void onCommandGetDebug(Stream& reply, int argc, const char** argv) {
                 strAudio.c_str(), strMotion.c_str(),
                 (outboundClientPressure.connected() ? strPressure.c_str() : "Not connected."),
                 (outboundClientDaylight.connected() ? strPhotoVal.c_str() : "Not connected."));
+  reply.printf("Frames: %lu sent, %lu unchanged and skipped\n", framesSent, framesSkipped);
+  printPollStatus(reply, pressurePoll);
+  printPollStatus(reply, daylightPoll);
+  reply.printf("ADC samples: %lu missed, %lu dropped\n", samplesMissed, adcSamples.getDroppedCount());
   
   reply.flush();
 }
 
+/**
+ * Prints how old a sensor's last reading is and how many polls went
+ * unanswered. get-debug shows the last readings collected, it does not wait
+ * for new ones.
+ */
+void printPollStatus(Stream& reply, SensorPoll& poll) {
+  if (poll.updateTime == 0)
+    reply.printf("Sensor %s: no reading yet", poll.name);
+  else
+    reply.printf("Sensor %s: reading %lu mS old", poll.name,
+        (unsigned long)(millis() - poll.updateTime));
+  reply.printf(", %lu timeouts\n", poll.timeouts);
+}
+
 void onCommandDropRemote(Stream& reply, int argc, const char** argv) {
   outboundClientDaylight.stop();
   outboundClientPressure.stop();
@@ -943,6 +1194,16 @@ void onCommandDropRemote(Stream& reply, int argc, const char** argv) {
   reply.flush();
 }
 
+/**
+ * Pushed by the squirrel when a node registers with a new address.
+ * Usage: ip-changed <name> <ip>
+ */
+void onCommandIpChanged(Stream& reply, int argc, const char** argv) {
+  IPAddress ip;
+  if (argc == 2 && ip.fromString(argv[1]))
+    slaveNames.update(argv[0], ip);
+}
+
 /**
  * Toggles turning the lumen nodes on and off.
  * This function is called when the sound sensor hears two quick claps.
@@ -24,6 +24,7 @@
 
 //Custom libraries
 #include <CommandInterpreter.h>
+#include <LumenFrame.h>
 
 //Uncomment the hardware platform
 //#define SONOFF_B1 0
@@ -42,6 +43,7 @@ const IPAddress broadcastAddress(192, 168, 3, 255);
 const IPAddress serverAddress(   192, 168, 3, 1);
 const int DEBUG_PORT = 24;
 const int DATA_PORT = 23;
+const int FRAME_PORT = 26;
 
 //Our definition of "warm" varies from platform to platform... how to do this?
 #ifdef SONOFF_B1
@@ -60,6 +62,7 @@ my9291 ledDriver = my9291(LED_DATA_PIN, LED_CLCK_PIN, MY9291_COMMAND_DEFAULT);
 //When iocontrol connects, it will be here
 WiFiUDP clientIoControl;
 WiFiUDP broadcast; 
+WiFiUDP frameSocket;
 CommandInterpreter serialCmd;
 CommandInterpreter ioCmd;
 
@@ -71,6 +74,11 @@ uint8_t colors[5];
 const int PACKET_DATA_SIZE = 64;
 char packetData[PACKET_DATA_SIZE];
 
+//Our line in iocontrol's frames, assigned when it hears our discovery packet.
+//Frames of another session (iocontrol restarted) are ignored until assigned again.
+int frameSlot = -1;
+long frameSession = -1;
+
 WiFiEventHandler disconnectedEventHandler;
 
 void setup() {
@@ -97,9 +105,12 @@ void setup() {
   Serial.print("WiFi ready to connect\n");
 
   //Assign some commands to the command controllers
-  serialCmd.assign("c", commandSetColors);
-  serialCmd.assign("t", commandSetTemp);
+  serialCmd.assign("c", commandSetColors, "u8 u8 u8 [u8] [u8]");
+  serialCmd.assign("t", commandSetTemp, "u8 [u8]");
+  serialCmd.assign("slot", commandSetSlot, "u8 u16");
   ioCmd = CommandInterpreter(serialCmd);
+  //Data is fire and forget, malformed commands are ignored as before
+  ioCmd.enableErrorReplies(false);
 }
 
 void triggerReconnect(const WiFiEventStationModeDisconnected& event) {
@@ -118,7 +129,7 @@ void loop() {
     
     //UDP Broadcast ourself!
     broadcast.beginPacket(broadcastAddress, DATA_PORT);
-    broadcast.print("d"); //d = discover
+    broadcast.print("db"); //d = discover, b = reads binary frames
     broadcast.endPacket();
 
     lastComTime = millis();
@@ -129,14 +140,34 @@ void loop() {
 
   //Handle UDP data stream (from iocontrol)
   ioCmd.handleUdp(clientIoControl);
+  handleFrame();
+}
+
+/**
+ * Applies our slot of a frame datagram, if one has arrived. Frames are text
+ * or binary, see LumenFrame.
+ */
+void handleFrame() {
+  char command;
+  CommandInterpreter::Argument argv[LumenFrame::MAX_CHANNELS];
+  int count;
+  if (!LumenFrame::decode(frameSocket, frameSession, frameSlot, command, argv, count))
+    return;
+
+  //Hand the values to the usual command
+  if (command == 'c')
+    commandSetColors(Serial, count, argv);
+  else
+    commandSetTemp(Serial, count, argv);
 }
 
 void handleReconnect() {
   
   while (reconnect) {
 
-    //Close the UDP data socket
+    //Close the UDP data sockets
     clientIoControl.stop();
+    frameSocket.stop();
     
     //Wait for wifi for 5 seconds
     Serial.print("Wait\n");
@@ -150,6 +181,7 @@ void handleReconnect() {
 
     //Open udp port for lumen data
     clientIoControl.begin(DATA_PORT);
+    frameSocket.begin(FRAME_PORT);
     
     reconnect = false;
     
@@ -200,17 +232,13 @@ void handleReconnect() {
   //broadcast.stop();
 }*/
 
-void commandSetTemp(Stream& port, int argc, const char** argv) {
+void commandSetTemp(Stream& port, int argc, const CommandInterpreter::Argument* argv) {
 
   lastComTime = millis();
-  
-  if (argc != 1 && argc != 2) {
-    return;
-  }
 
   //The multiplier defines where we are from cool to warm
-  float multiplier = (float)atoi(argv[0]) / 255.0f;
-  float brightness = argc == 2 ? (float)atoi(argv[1]) / 255.0f : 1.0f;
+  float multiplier = (float)argv[0].integer / 255.0f;
+  float brightness = argc == 2 ? (float)argv[1].integer / 255.0f : 1.0f;
 
   for (int i = 0; i < 5; i ++) {
     float channelRaw = ((float)warmColor[i] + 
@@ -222,19 +250,22 @@ void commandSetTemp(Stream& port, int argc, const char** argv) {
   ledDriver.setColor((my9291_color_t){colors[0], colors[1], colors[2], colors[3], colors[4]});
 }
 
-void commandSetColors(Stream& port, int argc, const char** argv) {
+void commandSetSlot(Stream& port, int argc, const CommandInterpreter::Argument* argv) {
 
   lastComTime = millis();
+  frameSlot = argv[0].integer;
+  frameSession = argv[1].integer;
+}
 
-  if (argc < 3 || argc > 5) {
-    return;
-  }
+void commandSetColors(Stream& port, int argc, const CommandInterpreter::Argument* argv) {
+
+  lastComTime = millis();
 
-  colors[0] = (uint8_t)atoi(argv[0]);
-  colors[1] = (uint8_t)atoi(argv[1]);
-  colors[2] = (uint8_t)atoi(argv[2]);
-  colors[3] = argc > 3 ? (uint8_t)atoi(argv[3]) : 0;
-  colors[4] = argc > 4 ? (uint8_t)atoi(argv[4]) : 0;
+  colors[0] = (uint8_t)argv[0].integer;
+  colors[1] = (uint8_t)argv[1].integer;
+  colors[2] = (uint8_t)argv[2].integer;
+  colors[3] = argc > 3 ? (uint8_t)argv[3].integer : 0;
+  colors[4] = argc > 4 ? (uint8_t)argv[4].integer : 0;
   
   ledDriver.setColor((my9291_color_t){colors[0], colors[1], colors[2], colors[3], colors[4]});
 }
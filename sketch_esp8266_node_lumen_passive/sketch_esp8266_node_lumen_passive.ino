@@ -30,6 +30,7 @@
 
 //Custom libraries
 #include <CommandInterpreter.h>
+#include <LumenFrame.h>
 #include <my9231.h>;
 #include "Persistence.h"
 #include "MultiStringStream.h"
@@ -50,6 +51,8 @@ const uint8_t   PAIR_CYCLE_COUNT = 5;
 const int       PACKET_DATA_MAX_SIZE = 64;
 const uint16_t  DNS_PORT = 53;
 const uint16_t  HTTP_SERVER_PORT = 80;
+const uint16_t  FRAME_PORT = 26;
+const uint16_t  IO_CONTROL_DISCOVERY_PORT = 23;
 const uint16_t  PAIRING_RESET_TIMEOUT = 4000;
 const uint16_t  CHECK_ADDRESS_TIMEOUT = 2000;
 const uint16_t  POLL_CONNECTION_TIMEOUT = 5000;
@@ -89,6 +92,7 @@ const uint8_t coolColor[] = {  0,   0,  0,  255,   0};
 IPAddress broadcastAddress;
 WiFiUDP clientData;
 WiFiUDP broadcast; 
+WiFiUDP frameSocket;
 CommandInterpreter serialCmd;
 CommandInterpreter dataCmd;
 ESP8266WebServer webServer(HTTP_SERVER_PORT);
@@ -102,6 +106,11 @@ Persistence persistence;
 WiFiEventHandler disconnectedEventHandler;
 uint8_t colors[5];
 
+//Our line in the controller's frames, assigned with the slot command. Frames
+//of another session (controller restarted) are ignored until assigned again.
+int frameSlot = -1;
+long frameSession = -1;
+
 //--------------------------------------
 //  NORMAL CONTROLLER
 //--------------------------------------
@@ -119,13 +128,16 @@ void setupNormal() {
   Serial.print("WiFi ready to connect\n");
 
   //Assign some commands to the command controllers
-  serialCmd.assign("c", commandSetColors);
-  serialCmd.assign("t", commandSetTemp);
-  serialCmd.assign("hsv", commandSetColorsHsv);
-  serialCmd.assign("calibrate-hue", commandSetHueCalibration);
+  serialCmd.assign("c", commandSetColors, "u8 u8 u8 [u8] [u8]");
+  serialCmd.assign("t", commandSetTemp, "u8 [u8]");
+  serialCmd.assign("hsv", commandSetColorsHsv, "float float float [int]");
+  serialCmd.assign("calibrate-hue", commandSetHueCalibration, "float float float float float float");
   serialCmd.assign("set-name", commandSetName);
   serialCmd.assign("pair", commandPair);
+  serialCmd.assign("slot", commandSetSlot, "u8 u16");
   dataCmd = CommandInterpreter(serialCmd);
+  //Data is fire and forget, malformed commands are ignored as before
+  dataCmd.enableErrorReplies(false);
 }
 
 void triggerReconnect(const WiFiEventStationModeDisconnected& event) {
@@ -174,6 +186,12 @@ void loopNormal() {
         FIRMWARE_VERSION, persistence.getName());
     broadcast.endPacket();
 
+    //Ask iocontrol for a slot in its frames too (b = reads binary frames),
+    //answered on our data port
+    broadcast.beginPacket(broadcastAddress, IO_CONTROL_DISCOVERY_PORT);
+    broadcast.printf("db %u\n", persistence.getPort());
+    broadcast.endPacket();
+
     lastComTime = millis();
     lastAddrCheckTime = millis();
   }
@@ -190,6 +208,25 @@ void loopNormal() {
   //Handle incoming commands
   serialCmd.handle(Serial);
   dataCmd.handleUdp(clientData);
+  handleFrame();
+}
+
+/**
+ * Applies our slot of a frame datagram, if one has arrived. Frames are text
+ * or binary, see LumenFrame.
+ */
+void handleFrame() {
+  char command;
+  CommandInterpreter::Argument argv[LumenFrame::MAX_CHANNELS];
+  int count;
+  if (!LumenFrame::decode(frameSocket, frameSession, frameSlot, command, argv, count))
+    return;
+
+  //Hand the values to the usual command
+  if (command == 'c')
+    commandSetColors(Serial, count, argv);
+  else
+    commandSetTemp(Serial, count, argv);
 }
 
 /**
@@ -200,8 +237,9 @@ void handleReconnect() {
   
   while (reconnect) {
 
-    //Close the UDP data socket
+    //Close the UDP data sockets
     clientData.stop();
+    frameSocket.stop();
     
     //Wait for wifi for 5 seconds
     Serial.print("Wait\n");
@@ -215,6 +253,7 @@ void handleReconnect() {
 
     //Open udp port for lumen data
     clientData.begin(persistence.getPort());
+    frameSocket.begin(FRAME_PORT);
     
     reconnect = false;
   }
@@ -225,17 +264,13 @@ void handleReconnect() {
  * Temperature is an integer 0 to 255, where 255 is cool and 0 is warm.
  * Usage: t temp
  */
-void commandSetTemp(Stream& port, int argc, const char** argv) {
+void commandSetTemp(Stream& port, int argc, const CommandInterpreter::Argument* argv) {
 
   lastComTime = millis();
-  
-  if (argc != 1 && argc != 2) {
-    return;
-  }
 
   //The multiplier defines where we are from cool to warm
-  float multiplier = (float)atoi(argv[0]) / 255.0f;
-  float brightness = argc == 2 ? (float)atoi(argv[1]) / 255.0f : 1.0f;
+  float multiplier = (float)argv[0].integer / 255.0f;
+  float brightness = argc == 2 ? (float)argv[1].integer / 255.0f : 1.0f;
 
   for (int i = 0; i < 5; i ++) {
     float channelRaw = ((float)warmColor[i] + 
@@ -247,24 +282,31 @@ void commandSetTemp(Stream& port, int argc, const char** argv) {
   ledDriver.setColor((my9291_color_t){colors[0], colors[1], colors[2], colors[3], colors[4]});
 }
 
+/**
+ * Assigns our line in frame datagrams, and the session they must carry.
+ * Usage: slot index session
+ */
+void commandSetSlot(Stream& port, int argc, const CommandInterpreter::Argument* argv) {
+
+  lastComTime = millis();
+  frameSlot = argv[0].integer;
+  frameSession = argv[1].integer;
+}
+
 /**
  * Sets all of the available channels if they are provided. Requires at least RGB channels. 
  * Values are integers in the range 0 to 255.
  * Usage: c red green blue [white] [warm]
  */
-void commandSetColors(Stream& port, int argc, const char** argv) {
+void commandSetColors(Stream& port, int argc, const CommandInterpreter::Argument* argv) {
 
   lastComTime = millis();
 
-  if (argc < 3 || argc > 5) {
-    return;
-  }
-
-  colors[0] = (uint8_t)atoi(argv[0]);
-  colors[1] = (uint8_t)atoi(argv[1]);
-  colors[2] = (uint8_t)atoi(argv[2]);
-  colors[3] = argc > 3 ? (uint8_t)atoi(argv[3]) : 0;
-  colors[4] = argc > 4 ? (uint8_t)atoi(argv[4]) : 0;
+  colors[0] = (uint8_t)argv[0].integer;
+  colors[1] = (uint8_t)argv[1].integer;
+  colors[2] = (uint8_t)argv[2].integer;
+  colors[3] = argc > 3 ? (uint8_t)argv[3].integer : 0;
+  colors[4] = argc > 4 ? (uint8_t)argv[4].integer : 0;
   
   ledDriver.setColor((my9291_color_t){colors[0], colors[1], colors[2], colors[3], colors[4]});
 }
@@ -276,20 +318,18 @@ void commandSetColors(Stream& port, int argc, const char** argv) {
  * Pass a positive non-0 integer to enable calibration, or simply omit the argument.
  * Usage: hsv hue sat val [calibration-enable]
  */
-void commandSetColorsHsv(Stream& port, int argc, const char** argv) {
+void commandSetColorsHsv(Stream& port, int argc, const CommandInterpreter::Argument* argv) {
 
   lastComTime = millis();
 
   bool calibrate = true;
-  if (argc != 3 && argc != 4)
-    return;
   if (argc == 4)
-    calibrate = atoi(argv[3]) > 0;
+    calibrate = argv[3].integer > 0;
 
-  float hue = atof(argv[0]);
+  float hue = argv[0].decimal;
   if (calibrate)
     hue = calibrateHue(hue);
-  hsvToRgb(hue, atof(argv[1]), atof(argv[2]),
+  hsvToRgb(hue, argv[1].decimal, argv[2].decimal,
       colors[0], colors[1], colors[2]);
 
   colors[3] = 0;
@@ -303,15 +343,11 @@ void commandSetColorsHsv(Stream& port, int argc, const char** argv) {
  * color. For example, moving 60 to 70 would produce a yellow that was more green.
  * Usage: calibrate-hue 0 60 120 180 240 300
  */
-void commandSetHueCalibration(Stream& port, int argc, const char** argv) {
+void commandSetHueCalibration(Stream& port, int argc, const CommandInterpreter::Argument* argv) {
   lastComTime = millis();
 
-  if (argc != 6) {
-    return;
-  }
-
-  float calibrations[] = {atof(argv[0]), atof(argv[1]), atof(argv[2]), 
-      atof(argv[3]), atof(argv[4]), atof(argv[5])};
+  float calibrations[] = {argv[0].decimal, argv[1].decimal, argv[2].decimal, 
+      argv[3].decimal, argv[4].decimal, argv[5].decimal};
 
   persistence.setHues(&calibrations[0]);
   if (persistence.getIsDirty()) {
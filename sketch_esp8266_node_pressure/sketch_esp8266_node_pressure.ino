@@ -22,6 +22,7 @@
 
 #include <TcpClientRegistrar.h>
 #include <CommandInterpreter.h>
+#include <SensorSubscription.h>
 #include <UdpStream.h>
 #include <Pcf8591.h>
 
@@ -32,8 +33,14 @@ bool reconnect = true;
 WiFiEventHandler disconnectedEventHandler;
 CommandInterpreter ioCmd;
 UdpStream inboundIoControl;
+WiFiUDP announceSocket;
+TcpClientRegistrar::Announcement announcement;
 Pcf8591 ioChip(&Wire);
 
+//Readings pushed to iocontrol instead of polled
+uint8_t readLevel();
+SensorSubscription subscription(inboundIoControl, readLevel);
+
 void setup() {
   Serial.begin(9600);
   delay(500);
@@ -46,6 +53,7 @@ void setup() {
   disconnectedEventHandler = WiFi.onStationModeDisconnected(&triggerReconnect);
 
   ioCmd.assign("g", getPressure);
+  ioCmd.assign("subscribe", subscribe, SensorSubscription::SCHEMA);
 }
 
 void loop() {
@@ -57,6 +65,7 @@ void loop() {
   ioCmd.handle(Serial);
   ioCmd.handle(inboundIoControl);
   
+  subscription.handle();
   handleHeartbeat();
 }
 
@@ -80,6 +89,15 @@ void triggerReconnect(const WiFiEventStationModeDisconnected& event) {
 }
 
 void handleReconnect() {
+  //Registration goes on while the loop runs. A squirrel that does not answer
+  //announcements registers us with a TCP handshake instead.
+  if (announcement.poll() == TcpClientRegistrar::Announcement::TIMED_OUT) {
+    announcement.reset();
+    WiFiClient registerClient;
+    if (!TcpClientRegistrar::connectClient(
+          registerClient, IPAddress(192, 168, 3, 1), 23, "pressure", false))
+      reconnect = true;
+  }
   
   while (reconnect) {
     //Wait for wifi for 5 seconds
@@ -91,22 +109,36 @@ void handleReconnect() {
       continue;
     }
 
-    //Try to connect persistently to squirrel
-    WiFiClient registerClient;
-    if (TcpClientRegistrar::connectClient(
-          registerClient, IPAddress(192, 168, 3, 1), 23, "pressure", false))
-      reconnect = false;
-
     //Open the UDP socket
     inboundIoControl.begin(400);
+
+    //Announce to squirrel with one datagram
+    announceSocket.begin(TcpClientRegistrar::ANNOUNCE_PORT);
+    announcement.begin(announceSocket, IPAddress(192, 168, 3, 255), "pressure", 400);
+    reconnect = false;
   }
 }
 
-void getPressure(Stream& reply, int argc, const char** argv) {
+/**
+ * Samples the pressure level from the analog input.
+ */
+uint8_t readLevel() {
   uint32_t pinValues = ioChip.readAll(0);
   uint8_t* pin = reinterpret_cast<uint8_t*>(&pinValues);
-  reply.printf("%i\n", pin[0]);
+  return pin[0];
+}
+
+void getPressure(Stream& reply, int argc, const char** argv) {
+  reply.printf("%i\n", readLevel());
   reply.flush();
 }
 
+/**
+ * Pushes readings to iocontrol, see SensorSubscription.
+ * Usage: subscribe rate-ms [delta]
+ */
+void subscribe(Stream& reply, int argc, const CommandInterpreter::Argument* argv) {
+  subscription.subscribe(reply, argc, argv);
+}
+
 
@@ -39,16 +39,28 @@ const uint8_t MAX_AP_CLIENTS = 12;
 WiFiClient* clientMobile    = NULL;
 WiFiClient* clientLaptop    = NULL;
 WiFiUDP clientRemoteDebug;
+WiFiUDP announceSocket;
 UdpStream outboundIoControl;
 UdpStream inboundIoControl;
 
-//Interpreters for user connections (clones, w/ separate buffers)
-CommandInterpreter serialCmd;
-CommandInterpreter mobileCmd;
-CommandInterpreter laptopCmd;
-CommandInterpreter ioCmd;
+//User commands, registered once and shared by every user connection
+CommandRegistry userCommands;
+
+//Interpreters for user connections (sessions w/ separate buffers)
+CommandInterpreter serialCmd(userCommands);
+CommandInterpreter mobileCmd(userCommands);
+CommandInterpreter laptopCmd(userCommands);
 CommandInterpreter remoteDebugCmd;
 
+//IO Control port commands, one session per peer so several nodes can share
+//the port without mixing up their sequence numbers or replies
+const int IO_PEERS = 4;
+CommandRegistry ioCommands;
+CommandInterpreter ioCmd[IO_PEERS] = {
+  CommandInterpreter(ioCommands), CommandInterpreter(ioCommands),
+  CommandInterpreter(ioCommands), CommandInterpreter(ioCommands)
+};
+
 //TCP server and the client id registrar: Handle reconnects seamlessly
 WiFiServer listenSocket(23);
 TcpClientRegistrar clients;
@@ -82,42 +94,39 @@ void setup() {
   Serial.print("DEBUG: Name server is ready\n");
 
   clientRemoteDebug.begin(24);
+  announceSocket.begin(TcpClientRegistrar::ANNOUNCE_PORT);
 
   //iocontrol commands
-  ioCmd.assignDefault(commandNotFound);
-  ioCmd.assign("ip", commandGetIp);
+  ioCommands.assignDefault(commandNotFound);
+  ioCommands.assign("ip", commandGetIp);
 
   //Register local user commands to handler functions
-  serialCmd.assignDefault(commandNotFound);
-  serialCmd.assign("ip",          commandGetIp);
-  serialCmd.assign("identify",    commandIdentify);
-  serialCmd.assign("help",        commandHelp);
-  serialCmd.assign("test-args",   commandTestArgs);
-  serialCmd.assign("set-timeout", commandSetTimeout);
-  serialCmd.assign("get-stats",   commandGetStats);
-  serialCmd.assign("drop-remote", commandDropRemote);
+  userCommands.assignDefault(commandNotFound);
+  userCommands.assign("ip",          commandGetIp);
+  userCommands.assign("identify",    commandIdentify);
+  userCommands.assign("help",        commandHelp);
+  userCommands.assign("test-args",   commandTestArgs);
+  userCommands.assign("set-timeout", commandSetTimeout);
+  userCommands.assign("get-stats",   commandGetStats);
+  userCommands.assign("drop-remote", commandDropRemote);
 
   //Remote user commands (proxy them to IOControl)
-  serialCmd.assign("color",          onSetColor);
-  serialCmd.assign("get-color",      onGetColor);
-  serialCmd.assign("temp",           onSetTemp);
-  serialCmd.assign("get-temp",       onGetTemp);
-  serialCmd.assign("brightness",     onSetBrightness);
-  serialCmd.assign("get-brightness", onGetBrightness);
-  serialCmd.assign("clap",           onSetClap);
-  serialCmd.assign("get-clap",       onGetClap);
-  serialCmd.assign("power",          onSetPower);
-  serialCmd.assign("get-power",      onGetPower);
-  serialCmd.assign("motion",         onSetMotion);
-  serialCmd.assign("get-motion",     onGetMotion);
-  serialCmd.assign("get-mode",       onGetMode);
-  serialCmd.assign("listen",         onSetListen);
-  serialCmd.assign("get-debug",      onGetDebug);
+  userCommands.assign("color",          onSetColor);
+  userCommands.assign("get-color",      onGetColor);
+  userCommands.assign("temp",           onSetTemp);
+  userCommands.assign("get-temp",       onGetTemp);
+  userCommands.assign("brightness",     onSetBrightness);
+  userCommands.assign("get-brightness", onGetBrightness);
+  userCommands.assign("clap",           onSetClap);
+  userCommands.assign("get-clap",       onGetClap);
+  userCommands.assign("power",          onSetPower);
+  userCommands.assign("get-power",      onGetPower);
+  userCommands.assign("motion",         onSetMotion);
+  userCommands.assign("get-motion",     onGetMotion);
+  userCommands.assign("get-mode",       onGetMode);
+  userCommands.assign("listen",         onSetListen);
+  userCommands.assign("get-debug",      onGetDebug);
   
-  //Allow mobile and laptop to do everything that the serial term can (copy)
-  mobileCmd = CommandInterpreter(serialCmd);
-  laptopCmd = CommandInterpreter(serialCmd);
-
   serialCmd.enableEcho(true);
   serialCmd.enableSequenceNumbers(true);
 
@@ -127,8 +136,14 @@ void setup() {
   //Register client IDs to respective pointers for auto connection handling
   clients.assign("laptop", &clientLaptop);
   clients.assign("mobile", &clientMobile);
+  clients.onChange(pushRegistration);
 
+  inboundIoControl.enablePeers(IO_PEERS);
   Serial.printf("DEBUG: Listening to IO Control, state is %i\n", inboundIoControl.begin(201));
+
+  //Commands to IO Control are acknowledged and retransmitted on loss, the
+  //IO Control side enables the same
+  outboundIoControl.enableReliable(true);
 }
 
 void loop() {
@@ -136,6 +151,7 @@ void loop() {
   handleReconnect();
   
   clients.handle(listenSocket);
+  clients.handleAnnounce(announceSocket);
   
   //Handle dispatching commands from various sources if they are available
   serialCmd.handle(Serial);
@@ -143,8 +159,10 @@ void loop() {
   if (clientMobile)
     mobileCmd.handle(*clientMobile);
   if (clientLaptop)
-    mobileCmd.handle(*clientLaptop);
-  ioCmd.handle(inboundIoControl);
+    laptopCmd.handle(*clientLaptop);
+  //Reading any peer takes in packets for all of them, idle ones read nothing
+  for (int i = 0; i < IO_PEERS; i++)
+    ioCmd[i].handle(inboundIoControl.peer(i));
 
   handleHeartbeat();
 }
@@ -159,15 +177,28 @@ void loop() {
 void handleReconnect() {
 
   static int ioReconnectTimeout = 0;
-  if (!outboundIoControl.connected() && millis() - ioReconnectTimeout > 2000) {
+  UdpStream::ConnectState ioState = outboundIoControl.getState();
+  bool ioIdle = ioState == UdpStream::STOPPED || ioState == UdpStream::FAILED;
+  if (ioIdle && millis() - ioReconnectTimeout > 2000) {
     ioReconnectTimeout = millis();
     Serial.print("DEBUG: Attempting connect to IOControl\n");
     
     if (outboundIoControl.begin(clients.findIp("iocontrol"), 200))
-      Serial.print("DEBUG: Successfully connected to IOControl\n");
+      Serial.print("DEBUG: Syncing with IOControl\n");
   }
 }
 
+/**
+ * Tells IO Control when a node registers with a new address, so its cached
+ * lookups stay current without asking.
+ */
+void pushRegistration(const char* identity, IPAddress ip) {
+  if (!outboundIoControl.connected())
+    return;
+  outboundIoControl.printf("ip-changed %s %s\n", identity, ip.toString().c_str());
+  outboundIoControl.flush();
+}
+
 /**
  * Blinks the output LED at the given rate
  */
@@ -185,6 +216,9 @@ void handleHeartbeat() {
 //    REMOTE COMMAND HANDLERS
 //******************************************************************************
 
+//Request ID of the last command proxied to another node
+uint16_t proxyRequestId = 0;
+
 /**
  * Reused by many handler functions to invoke remote commands without too much logic.
  */
@@ -209,10 +243,19 @@ void simpleProxyHandler(Stream& port, int argc, const char** argv, char* command
   for (int i = 0; i < argc; i++) {
     toPrint += String(" ") + String(argv[i]);
   }
-  remote.printf("%s\n", toPrint.c_str());
+  
+  //Tag the request so a late reply to an earlier request is not taken for ours
+  proxyRequestId++;
+  char tag[8];
+  int tagLength = sprintf(tag, "#%u ", proxyRequestId);
+  remote.printf("%s%s\n", tag, toPrint.c_str());
   remote.flush();
 
-  String response = remote.readStringUntil('\n');
+  String response;
+  do {
+    response = remote.readStringUntil('\n');
+  } while (response.length() > 0 && !response.startsWith(tag));
+  
   if (response.length() == 0) {
 
     port.print("ER: Remote node timed out\n");
@@ -220,7 +263,7 @@ void simpleProxyHandler(Stream& port, int argc, const char** argv, char* command
     return;
   }
 
-  port.printf("%s\n", response.c_str());
+  port.printf("%s\n", response.c_str() + tagLength);
 }
 
 void onSetColor(Stream& port, int argc, const char** argv) {
@@ -319,6 +362,7 @@ void commandHelp(Stream& port, int argc, const char** argv) {
   port.print("test-args ........... Test argument parser\n");
   port.print("set-timeout ......... Connection command timeout\n");
   port.print("get-stats ........... Get send/recv counters\n");
+  port.print("cmd-stats [on/off] .. Command timing stats\n");
   port.print("drop-remote ......... Kill remote connections\n");
   port.print("\n");
   port.flush();